@@ -1,16 +1,181 @@
 #include "Nurikabe.h"
 #include <iostream>
-#include <chrono>
+#include <sstream>
 #include <assert.h>
 #include <cstring>
+#include <csignal>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <numeric>
+
+static bool HasSameBlacks(const Nurikabe::Board& a, const Nurikabe::Board& b)
+{
+	if (a.GetWidth() != b.GetWidth() || a.GetHeight() != b.GetHeight())
+		return false;
+
+	for (int y = 0; y < a.GetHeight(); y++)
+	{
+		for (int x = 0; x < a.GetWidth(); x++)
+		{
+			if (a.IsBlack({ x, y }) != b.IsBlack({ x, y }))
+				return false;
+		}
+	}
+	return true;
+}
+
+// Solves one JSON request per line of stdin, see NurikabeRequest.h.
+static int RunStream(const Nurikabe::Solver::SolveSettings& settings, Nurikabe::SolutionCache* cache)
+{
+	std::string line;
+	std::string output;
+	while (std::getline(std::cin, line))
+	{
+		if (line.find_first_not_of(" \t\r") == std::string::npos)
+			continue;
+
+		Nurikabe::Request request;
+		Nurikabe::Result result;
+		if (request.Parse(line, result.error))
+			result = Nurikabe::SolveRequest(request, settings, cache);
+		else
+			result.id = request.id;
+
+		output.clear();
+		result.Write(output);
+
+		// one flush per record, so a reader waiting for a result gets it right away
+		std::cout.write(output.data(), output.size());
+		std::cout.flush();
+	}
+
+	return 0;
+}
+
+static Nurikabe::Server* runningServer = nullptr;
+
+static void StopServer(int)
+{
+	runningServer->Stop();
+}
+
+static int RunServer(const char* socketPath, const Nurikabe::Server::Settings& serverSettings)
+{
+	Nurikabe::Server server(serverSettings);
+	if (!server.Open(socketPath))
+	{
+		std::cout << "Failed to listen on '" << socketPath << "'" << '\n';
+		return 1;
+	}
+
+	runningServer = &server;
+	std::signal(SIGINT, StopServer);
+	std::signal(SIGTERM, StopServer);
+
+	std::cout << "Listening on '" << socketPath << "'" << '\n';
+	bool isValid = server.Run();
+
+	runningServer = nullptr;
+	return isValid ? 0 : 1;
+}
+
+// Writes `count` new puzzles to stdout as a corpus, and with their solutions to a pack if one is given.
+static int RunGenerate(int count, const Nurikabe::Generator::Settings& generatorSettings, uint64_t seed, int threadCount, const char* packFilename)
+{
+	struct Generated
+	{
+		Nurikabe::Board puzzle;
+		Nurikabe::Board solution;
+		bool isValid = false;
+	};
+	std::vector<Generated> generated(count);
+
+	// every puzzle has its own seed, so the output does not depend on the number of threads
+	std::atomic<int> nextPuzzle = 0;
+	auto Work = [&]()
+	{
+		for (int i = nextPuzzle++; i < count; i = nextPuzzle++)
+		{
+			Nurikabe::Generator generator(generatorSettings, seed + i * 0x9E3779B97F4A7C15ull);
+			generated[i].isValid = generator.Generate(generated[i].puzzle, generated[i].solution);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; i++)
+		threads.emplace_back(Work);
+	Work();
+	for (auto& thread : threads)
+		thread.join();
+
+	Nurikabe::PackWriter packWriter;
+	if (packFilename && !packWriter.Open(packFilename))
+	{
+		std::cout << "Failed to create '" << packFilename << "'" << '\n';
+		return 1;
+	}
+
+	int failCount = 0;
+	std::string out;
+	for (int i = 0; i < count; i++)
+	{
+		if (!generated[i].isValid)
+		{
+			failCount++;
+			continue;
+		}
+
+		out += "# generated-" + std::to_string(seed) + "-" + std::to_string(i) + "\n";
+		generated[i].puzzle.Save(out);
+
+		if (packFilename)
+			packWriter.Add(generated[i].puzzle, &generated[i].solution);
+	}
+	std::cout.write(out.data(), out.size());
+
+	if (packFilename && !packWriter.Close())
+	{
+		std::cout << "Failed to write '" << packFilename << "'" << '\n';
+		return 1;
+	}
+
+	if (failCount > 0)
+		std::cerr << "Failed to generate " << failCount << " of " << count << " puzzles" << '\n';
+
+	return failCount;
+}
 
 int main(int argc, const char** argv)
 {
+	// everything goes through std::cout, there is no need to keep it in sync with printf
+	std::ios::sync_with_stdio(false);
+
 	Nurikabe::Solver::SolveSettings settings;
 	settings.maxDepth = 2;
 
 	std::vector<const char*> filenames;
+	const char* packFilename = nullptr;
+	const char* socketPath = nullptr;
+	const char* cacheFilename = nullptr;
+	Nurikabe::OutputFormat format = Nurikabe::OutputFormat::Human;
+	Nurikabe::Server::Settings serverSettings;
+	Nurikabe::Generator::Settings generatorSettings;
+	int generateCount = 0;
+	unsigned long long seed = 1;
+	int threadCount = 1;
+	Nurikabe::BenchmarkSettings benchmarkSettings;
+	benchmarkSettings.runs = 0;
+	const char* baselineFilename = nullptr;
+	double threshold = 0.1;
 
+	bool isStream = false;
+	bool isQuiet = false;
+	bool isStats = false;
+	bool isPerf = false;
+	double maxAllocationsPerIteration = -1.0;
+	const char* traceFilename = nullptr;
+	const char* logFilename = nullptr;
 	bool isFilename = false;
 	for (int i = 1; i < argc; i++)
 	{
@@ -26,6 +191,152 @@ int main(int argc, const char** argv)
 			sscanf(argv[i], "%d", &settings.stopAtIteration);
 		}
 
+		if (!std::strcmp(argv[i], "-p"))
+		{
+			i++;
+			packFilename = argv[i];
+		}
+
+		if (!std::strcmp(argv[i], "-c"))
+		{
+			i++;
+			cacheFilename = argv[i];
+		}
+
+		if (!std::strcmp(argv[i], "--serve"))
+		{
+			i++;
+			socketPath = argv[i];
+		}
+
+		if (!std::strcmp(argv[i], "-w"))
+		{
+			i++;
+			sscanf(argv[i], "%d", &serverSettings.workerCount);
+		}
+
+		if (!std::strcmp(argv[i], "-q"))
+		{
+			i++;
+			sscanf(argv[i], "%d", &serverSettings.queueCapacity);
+		}
+
+		if (!std::strcmp(argv[i], "--generate"))
+		{
+			i++;
+			sscanf(argv[i], "%d", &generateCount);
+		}
+
+		if (!std::strcmp(argv[i], "--size"))
+		{
+			i++;
+			sscanf(argv[i], "%dx%d", &generatorSettings.width, &generatorSettings.height);
+		}
+
+		if (!std::strcmp(argv[i], "--density"))
+		{
+			i++;
+			sscanf(argv[i], "%lf", &generatorSettings.density);
+		}
+
+		if (!std::strcmp(argv[i], "--clue-density"))
+		{
+			i++;
+			sscanf(argv[i], "%lf", &generatorSettings.clueDensity);
+		}
+
+		if (!std::strcmp(argv[i], "--island-size"))
+		{
+			i++;
+			sscanf(argv[i], "%lf", &generatorSettings.meanIslandSize);
+		}
+
+		if (!std::strcmp(argv[i], "--max-island-size"))
+		{
+			i++;
+			sscanf(argv[i], "%d", &generatorSettings.maxIslandSize);
+		}
+
+		if (!std::strcmp(argv[i], "--not-unique"))
+			generatorSettings.isUnique = false;
+
+		if (!std::strcmp(argv[i], "--seed"))
+		{
+			i++;
+			sscanf(argv[i], "%llu", &seed);
+		}
+
+		if (!std::strcmp(argv[i], "-j"))
+		{
+			i++;
+			sscanf(argv[i], "%d", &threadCount);
+		}
+
+		if (!std::strcmp(argv[i], "--bench"))
+		{
+			i++;
+			sscanf(argv[i], "%d", &benchmarkSettings.runs);
+		}
+
+		if (!std::strcmp(argv[i], "--warmup"))
+		{
+			i++;
+			sscanf(argv[i], "%d", &benchmarkSettings.warmupRuns);
+		}
+
+		if (!std::strcmp(argv[i], "--baseline"))
+		{
+			i++;
+			baselineFilename = argv[i];
+		}
+
+		if (!std::strcmp(argv[i], "--threshold"))
+		{
+			i++;
+			sscanf(argv[i], "%lf", &threshold);
+			threshold /= 100.0;
+		}
+
+		if (!std::strcmp(argv[i], "--stream"))
+			isStream = true;
+
+		if (!std::strcmp(argv[i], "--format"))
+		{
+			i++;
+			if (!Nurikabe::Output::ParseFormat(argv[i], format))
+			{
+				std::cout << "Unknown format '" << argv[i] << "'\n";
+				return 1;
+			}
+		}
+
+		if (!std::strcmp(argv[i], "--quiet"))
+			isQuiet = true;
+
+		if (!std::strcmp(argv[i], "--stats"))
+			isStats = true;
+
+		if (!std::strcmp(argv[i], "--perf"))
+			isPerf = true;
+
+		if (!std::strcmp(argv[i], "--trace"))
+		{
+			i++;
+			traceFilename = argv[i];
+		}
+
+		if (!std::strcmp(argv[i], "--log"))
+		{
+			i++;
+			logFilename = argv[i];
+		}
+
+		if (!std::strcmp(argv[i], "--max-allocations"))
+		{
+			i++;
+			sscanf(argv[i], "%lf", &maxAllocationsPerIteration);
+		}
+
 		if (!std::strcmp(argv[i], "-f"))
 		{
 			isFilename = true;
@@ -33,57 +344,353 @@ int main(int argc, const char** argv)
 		}
 	}
 
+	Nurikabe::SolutionCache cache;
+	if (cacheFilename && !cache.Open(cacheFilename))
+	{
+		std::cout << "Failed to open solution cache '" << cacheFilename << "'" << '\n';
+		return 1;
+	}
+	Nurikabe::SolutionCache* usedCache = cacheFilename ? &cache : nullptr;
+
+	if (generateCount > 0)
+		return RunGenerate(generateCount, generatorSettings, seed, threadCount, packFilename);
+
+	if (isStream)
+		return RunStream(settings, usedCache);
+
+	if (socketPath)
+	{
+		serverSettings.solveSettings = settings;
+		serverSettings.cache = usedCache;
+		return RunServer(socketPath, serverSettings);
+	}
+
 	if (filenames.size() == 0)
 	{
-		std::cout << "Usage: NurikabeSolver [-i <iteration_to_stop_at>] -f <filename1> [filename2] [filename3] ..." << std::endl;
+		std::cout << "Usage: NurikabeSolver [-i <iteration_to_stop_at>] [-c <solution_cache>] [-p <pack_to_write>] [--format human|compact|json] [--quiet] [--stats] [--perf] [--max-allocations <per_iteration>] [--trace <file>] [--log <file>] [-j <threads>] -f <filename1> [filename2] [filename3] ..." << '\n';
+		std::cout << "       NurikabeSolver [-i <iteration_to_stop_at>] [-c <solution_cache>] --stream" << '\n';
+		std::cout << "       NurikabeSolver [-i <iteration_to_stop_at>] [-c <solution_cache>] [-w <workers>] [-q <queue_size>] --serve <socket>" << '\n';
+		std::cout << "       NurikabeSolver [-i <iteration_to_stop_at>] [--warmup <runs>] [--baseline <results>] [--threshold <percent>] --bench <runs> -f <filename1> [filename2] ..." << '\n';
+		std::cout << "       NurikabeSolver [--size <width>x<height>] [--density <white_share>] [--clue-density <clues_per_square>] [--island-size <mean>] [--max-island-size <size>]" << '\n';
+		std::cout << "                      [--not-unique] [--seed <seed>] [-j <threads>] [-p <pack_to_write>] --generate <count>" << '\n';
+		std::cout << "A file can hold several puzzles, each preceded by a line '# <name>', or be a binary pack." << '\n';
+		std::cout << "Clues above 9 are written as letters from 'a' for 10, or of any size as digits in parentheses like (120)." << '\n';
+		std::cout << "With -p every puzzle is written to a new pack together with its solution." << '\n';
+		std::cout << "With -j puzzles are solved on several threads, those estimated to take longest first, and still written in order." << '\n';
+		std::cout << "With --stream puzzles are read from stdin as JSON lines {\"id\":..., \"grid\":\"...\"} and a JSON line is written per puzzle." << '\n';
+		std::cout << "With --serve the same lines are accepted from clients of a Unix domain socket." << '\n';
+		std::cout << "With -c solutions are taken from and added to the cache file, also for rotated and mirrored puzzles." << '\n';
+		std::cout << "With --generate new puzzles with a single solution are written to stdout as a corpus, and with -p to a pack with their solutions." << '\n';
+		std::cout << "With --not-unique they are not solved while generating and may have other solutions, which is quick at any size, for" << '\n';
+		std::cout << "measuring with --bench how solving scales. Island sizes then follow a geometric distribution with the mean of --island-size." << '\n';
+		std::cout << "With --bench every puzzle is solved several times and timed, writing a JSON line per puzzle. Runs slower than" << '\n';
+		std::cout << "the same puzzle in the results of --baseline by more than --threshold percent (10 by default) are reported and fail." << '\n';
+		std::cout << "--format compact writes one line per puzzle: status, WxH, solution mask, iterations, runtime in ms and name." << '\n';
+		std::cout << "--format json writes one JSON line per puzzle, like --stream. --quiet stops printing the board while solving." << '\n';
+		std::cout << "--stats prints hits of the rule cache and calls, time, decided squares, contradictions and progress of every rule at the end, to stderr unless the format is human." << '\n';
+		std::cout << "Built with NURIKABE_ALLOCATIONS, --stats also prints allocations of every solve and --max-allocations fails solves" << '\n';
+		std::cout << "that allocate more often per iteration." << '\n';
+		std::cout << "--trace writes spans of rules, guesses and search nodes as Chrome Trace Event JSON, for Perfetto or chrome://tracing." << '\n';
+		std::cout << "--log writes every square decided by a rule or a guess to a binary log, which NurikabeReplay checks against the puzzles." << '\n';
+		std::cout << "--perf adds cycles, instructions, cache and branch misses of every rule, counted by perf events on Linux." << '\n';
 		return 0;
 	}
 
 	int failCount = 0;
 
-	for (int i = 0; i < filenames.size(); i++)
+	// benchmark results are JSON lines, which would be broken by anything else on stdout
+	const bool isBenchmark = benchmarkSettings.runs > 0;
+	if (isBenchmark)
+		format = Nurikabe::OutputFormat::Json;
+
+	std::vector<Nurikabe::BenchmarkResult> baseline;
+	if (baselineFilename && !Nurikabe::ReadBenchmarkResults(baselineFilename, baseline))
+	{
+		std::cerr << "Failed to read baseline '" << baselineFilename << "'" << '\n';
+		return 1;
+	}
+
+	Nurikabe::Output output(std::cout, format);
+
+	if (maxAllocationsPerIteration >= 0.0 && !Nurikabe::AllocationTracker::IsAvailable)
+	{
+		std::cerr << "Allocations are not tracked, build with NURIKABE_ALLOCATIONS" << '\n';
+		return 1;
+	}
+
+	if (isBenchmark && !Nurikabe::AllocationTracker::IsAvailable)
+		std::cerr << "Allocations are not tracked, build with NURIKABE_ALLOCATIONS to measure peakSolveBytes" << '\n';
+
+	if (traceFilename)
+		Nurikabe::Tracer::Enable();
+
+	if (isStats)
+		Nurikabe::Solver::isCountingPhaseStats = true;
+
+	if (isPerf && !Nurikabe::PerfCounters::Enable())
+	{
+		std::cerr << "Hardware counters are not available, check /proc/sys/kernel/perf_event_paranoid" << '\n';
+		isPerf = false;
+	}
+
+	// every puzzle is read before solving, so they can be spread over threads
+	struct Puzzle
 	{
+		std::string name;
+		std::string message;
 		Nurikabe::Board board;
-		if (!board.Load(filenames[i]))
+		Nurikabe::Board expected;
+		bool hasExpected = false;
+	};
+	std::vector<Puzzle> puzzles;
+
+	for (int i = 0; i < filenames.size(); i++)
+	{
+		const std::string filename = filenames[i];
+
+		Nurikabe::PackReader pack;
+		if (pack.Open(filenames[i]))
+		{
+			for (int puzzle = 0; puzzle < pack.GetCount(); puzzle++)
+			{
+				Puzzle& added = puzzles.emplace_back();
+				added.name = filename + " #" + std::to_string(puzzle);
+				added.message = "Solving '" + filename + "' #" + std::to_string(puzzle) + " ...\n";
+
+				if (!pack.Read(puzzle, added.board, &added.expected, &added.hasExpected))
+				{
+					output.WriteError("Failed to read puzzle #" + std::to_string(puzzle) + " of '" + filename + "'\n");
+					return 1;
+				}
+			}
+			continue;
+		}
+
+		// every file can hold more than one puzzle
+		Nurikabe::Corpus corpus;
+		if (!corpus.Open(filenames[i]))
+		{
+			output.WriteError("Failed to read '" + filename + "'\n");
+			return 1;
+		}
+
+		for (int puzzle = 0; puzzle < corpus.GetCount(); puzzle++)
+		{
+			Puzzle& added = puzzles.emplace_back();
+			if (!corpus.Load(puzzle, added.board))
+			{
+				output.WriteError("Failed to read puzzle #" + std::to_string(puzzle) + " of '" + filename + "'\n");
+				return 1;
+			}
+
+			added.name = filename;
+			added.message = "Solving '" + filename + "'";
+			if (corpus.GetCount() > 1)
+			{
+				added.name += " #" + std::to_string(puzzle);
+				added.message += " #" + std::to_string(puzzle) + " '" + std::string(corpus.GetName(puzzle)) + "'";
+			}
+			added.message += " ...\n";
+		}
+	}
+
+	// benchmarks are timed one puzzle at a time and logs are written in the order of solving
+	const bool isParallel = threadCount > 1 && puzzles.size() > 1 && !isBenchmark && !logFilename;
+
+	// boards printed while solving would break lines of the other formats, or of other threads
+	Nurikabe::ProgressPrinter progressPrinter(std::cout);
+	Nurikabe::Observer* observer = nullptr;
+	if (format == Nurikabe::OutputFormat::Human && !isQuiet && !isParallel)
+		observer = &progressPrinter;
+
+	Nurikabe::DeductionLogWriter logWriter(observer);
+	if (logFilename)
+	{
+		if (!logWriter.Open(logFilename))
 		{
-			std::cout << "Failed to read '" << filenames[i] << "'" << std::endl;
+			output.WriteError("Failed to create '" + std::string(logFilename) + "'\n");
 			return 1;
 		}
+		observer = &logWriter;
+	}
 
-		std::cout << "Solving '" << filenames[i] << "' ..." << std::endl;
+	Nurikabe::PackWriter packWriter;
+	if (packFilename && !packWriter.Open(packFilename))
+	{
+		output.WriteError("Failed to create '" + std::string(packFilename) + "'\n");
+		return 1;
+	}
 
-		int iteration = 0;
-		Nurikabe::Solver solver(board, &iteration);
+	auto BenchmarkPuzzle = [&settings, &failCount, &benchmarkSettings, &baseline, threshold](const std::string& name, const Nurikabe::Board& board)
+	{
+		auto result = Nurikabe::RunBenchmark(name, board, settings, benchmarkSettings);
 
-		auto timeStart = std::chrono::system_clock::now();
+		std::string line;
+		result.Write(line);
+		std::cout.write(line.data(), line.size());
+		std::cout.flush();
 
-		auto isSolved = solver.Solve(settings);
+		// unsolved puzzles are results too, for example when the iterations are limited
+		auto previous = std::find_if(baseline.begin(), baseline.end(), [&name](const Nurikabe::BenchmarkResult& other) { return other.name == name; });
+		if (previous != baseline.end() && Nurikabe::IsBenchmarkRegression(result, *previous, threshold))
+		{
+			std::cerr << "Regression in '" << name << "': " << result.medianMs << " ms, baseline " << previous->medianMs << " ms"
+				<< (result.isSolved || !previous->isSolved ? "" : ", no longer solved") << '\n';
+			failCount++;
+		}
+	};
 
-		auto timeStop = std::chrono::system_clock::now();
-		double timeElapsed = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(timeStop - timeStart).count();
-		timeElapsed /= 1'000'000.0;
+	auto SolvePuzzle = [&settings, &logWriter, logFilename, usedCache, observer](const Puzzle& puzzle)
+	{
+		// a solution from the cache leaves nothing to log, so logged puzzles are always solved
+		if (logFilename)
+			logWriter.Begin(puzzle.board);
+		auto result = Nurikabe::SolveBoard(puzzle.board, settings, logFilename ? nullptr : usedCache, observer);
+		if (logFilename)
+			logWriter.End();
 
-		if (!isSolved)
+		if (result.status == Nurikabe::Result::Status::Solved && puzzle.hasExpected && !HasSameBlacks(result.solution, puzzle.expected))
 		{
-			std::cout << "Failed to solve:" << std::endl << std::endl;
-			board.Print(std::cout);
+			result.status = Nurikabe::Result::Status::Error;
+			result.error = "Solution differs from the one in pack";
+		}
+
+		return result;
+	};
+
+	auto ReportPuzzle = [&failCount, &packWriter, &output, packFilename, format, isStats, maxAllocationsPerIteration](const Puzzle& puzzle, const Nurikabe::Result& result)
+	{
+		if (result.status != Nurikabe::Result::Status::Solved)
 			failCount++;
+
+		output.WriteResult(puzzle.name, puzzle.board, result);
+
+		if (isStats && Nurikabe::AllocationTracker::IsAvailable)
+		{
+			std::ostringstream stream;
+			result.allocations.Print(stream);
+			if (format == Nurikabe::OutputFormat::Human)
+				output.WriteMessage(stream.str());
+			else
+				std::cerr << stream.str();
 		}
-		else
+
+		// the budget is per iteration, so one limit fits puzzles of any size
+		if (maxAllocationsPerIteration >= 0.0 && !result.isCached)
 		{
-			std::cout << "Before and After:" << std::endl;
+			double allocationsPerIteration = (double)result.allocations.GetCount() / std::max(result.iterations, 1);
+			if (allocationsPerIteration > maxAllocationsPerIteration)
+			{
+				std::cerr << "Too many allocations in '" << puzzle.name << "': " << allocationsPerIteration << " per iteration, at most "
+					<< maxAllocationsPerIteration << " allowed" << '\n';
+				failCount++;
+			}
+		}
 
-			const Nurikabe::Board* boards[] = { &board, &solver.GetBoard() };
-			Nurikabe::Board::Print(boards, 2, std::cout);
-			std::cout << std::endl;
+		if (packFilename)
+			packWriter.Add(puzzle.board, result.status == Nurikabe::Result::Status::Solved ? &result.solution : nullptr);
+	};
+
+	if (!isParallel)
+	{
+		for (const auto& puzzle : puzzles)
+		{
+			output.WriteMessage(puzzle.message);
+
+			if (isBenchmark)
+			{
+				BenchmarkPuzzle(puzzle.name, puzzle.board);
+				continue;
+			}
+
+			// progress of the solver goes straight to stdout, it has to come after the name of the puzzle
+			if (observer)
+				output.Flush();
+
+			ReportPuzzle(puzzle, SolvePuzzle(puzzle));
 		}
+	}
+	else
+	{
+		// Puzzles are taken hardest first by their estimated cost, so a long one does not
+		// start last and keep one thread busy after all others are done. Results are
+		// still written in the order of the puzzles.
+		std::vector<double> costs(puzzles.size());
+		for (size_t i = 0; i < puzzles.size(); i++)
+			costs[i] = Nurikabe::EstimateDifficulty(puzzles[i].board).cost;
+
+		std::vector<int> order(puzzles.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&costs](int a, int b) { return costs[a] > costs[b]; });
+
+		std::vector<Nurikabe::Result> results(puzzles.size());
+		std::atomic<int> nextPuzzle = 0;
+		auto Work = [&]()
+		{
+			for (int i = nextPuzzle++; i < (int)order.size(); i = nextPuzzle++)
+				results[order[i]] = SolvePuzzle(puzzles[order[i]]);
+		};
+
+		std::vector<std::thread> threads;
+		for (int i = 1; i < threadCount; i++)
+			threads.emplace_back(Work);
+		Work();
+		for (auto& thread : threads)
+			thread.join();
+
+		for (size_t i = 0; i < puzzles.size(); i++)
+		{
+			output.WriteMessage(puzzles[i].message);
+			ReportPuzzle(puzzles[i], results[i]);
+		}
+	}
+
+	if (packFilename && !packWriter.Close())
+	{
+		output.WriteError("Failed to write '" + std::string(packFilename) + "'\n");
+		return 1;
+	}
+
+	if (logFilename && !logWriter.Close())
+	{
+		output.WriteError("Failed to write '" + std::string(logFilename) + "'\n");
+		return 1;
+	}
 
-		std::cout
-			<< "Runtime: " << timeElapsed << "ms" << std::endl
-			<< "Iterations: " << iteration << std::endl;
+	if (traceFilename && !Nurikabe::Tracer::Write(traceFilename))
+	{
+		output.WriteError("Failed to write '" + std::string(traceFilename) + "'\n");
+		return 1;
 	}
 
-	std::cout << std::endl << "Finished solving." << std::endl;
+	if (format == Nurikabe::OutputFormat::Human)
+	{
+		std::ostringstream stream;
+		if (isStats)
+		{
+			stream << '\n';
+			Nurikabe::Solver::PrintRuleCacheStats(stream);
+			stream << '\n';
+			Nurikabe::Solver::PrintPhaseStats(stream);
+		}
+		if (isPerf)
+		{
+			stream << '\n';
+			Nurikabe::PerfCounters::Print(stream);
+		}
+		stream << "\nFinished solving.\n";
+		output.WriteMessage(stream.str());
+	}
+	else
+	{
+		if (isStats)
+		{
+			Nurikabe::Solver::PrintRuleCacheStats(std::cerr);
+			Nurikabe::Solver::PrintPhaseStats(std::cerr);
+		}
+		if (isPerf)
+			Nurikabe::PerfCounters::Print(std::cerr);
+	}
 
 	return failCount;
 }
@@ -1,6 +1,23 @@
 #pragma once
 
 #include "NurikabeRules.h"
+#include "NurikabeAllocations.h"
+#include "NurikabeBenchmark.h"
 #include "NurikabeBoard.h"
+#include "NurikabeCorpus.h"
+#include "NurikabeDeductionLog.h"
+#include "NurikabeDifficulty.h"
+#include "NurikabeGenerator.h"
+#include "NurikabeMappedFile.h"
+#include "NurikabeObserver.h"
+#include "NurikabeOutput.h"
+#include "NurikabePack.h"
+#include "NurikabePatterns.h"
+#include "NurikabePerf.h"
+#include "NurikabeRequest.h"
+#include "NurikabeSolutionCache.h"
+#include "NurikabeSolutionCount.h"
+#include "NurikabeServer.h"
 #include "NurikabeSquare.h"
+#include "NurikabeTrace.h"
 #include "NurikabeSolver.h"
\ No newline at end of file
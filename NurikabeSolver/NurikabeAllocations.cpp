@@ -0,0 +1,137 @@
+#include "NurikabeAllocations.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace Nurikabe;
+
+// both are constant initialized, so operator new can use them at any time
+static thread_local AllocationTracker* activeTracker = nullptr;
+static thread_local AllocationCategory activeCategory = AllocationCategory::Other;
+static std::atomic<uint64_t> nextGeneration = 1;
+
+uint64_t AllocationStats::GetCount() const
+{
+	uint64_t count = 0;
+	for (const auto& counters : categories)
+		count += counters.count;
+	return count;
+}
+
+uint64_t AllocationStats::GetBytes() const
+{
+	uint64_t bytes = 0;
+	for (const auto& counters : categories)
+		bytes += counters.bytes;
+	return bytes;
+}
+
+void AllocationStats::Print(std::ostream& stream) const
+{
+	const char* names[] = { "other", "regions", "board copies", "solver copies", "solver stack" };
+	static_assert(sizeof(names) / sizeof(*names) == (int)AllocationCategory::Count);
+
+	char text[128];
+	std::snprintf(text, sizeof(text), "Allocations: %llu, %llu bytes, peak %lld bytes live (",
+		(unsigned long long)GetCount(), (unsigned long long)GetBytes(), (long long)peakLiveBytes);
+	stream << text;
+
+	for (int i = 0; i < (int)AllocationCategory::Count; i++)
+	{
+		std::snprintf(text, sizeof(text), "%s%s %llu", i > 0 ? ", " : "", names[i], (unsigned long long)categories[i].count);
+		stream << text;
+	}
+	stream << ")" << '\n';
+}
+
+AllocationTracker::AllocationTracker()
+	: liveBytes(0)
+	, previous(activeTracker)
+	, generation(nextGeneration.fetch_add(1, std::memory_order_relaxed))
+{
+	if (IsAvailable)
+		activeTracker = this;
+}
+
+AllocationTracker::~AllocationTracker()
+{
+	if (IsAvailable)
+		activeTracker = previous;
+}
+
+void AllocationTracker::OnAllocate(size_t size, AllocationCategory category)
+{
+	auto& counters = stats.categories[(int)category];
+	counters.count++;
+	counters.bytes += size;
+
+	liveBytes += size;
+	if (liveBytes > stats.peakLiveBytes)
+		stats.peakLiveBytes = liveBytes;
+}
+
+void AllocationTracker::OnFree(size_t size)
+{
+	liveBytes -= size;
+}
+
+AllocationScope::AllocationScope(AllocationCategory category)
+	: previous(activeCategory)
+{
+	activeCategory = category;
+}
+
+AllocationScope::~AllocationScope()
+{
+	activeCategory = previous;
+}
+
+#if NURIKABE_ALLOCATIONS
+
+// Every block starts with a header holding its size and the generation of the
+// tracker that counted it, so a free is only subtracted from the tracker that
+// saw the allocation, even when a later tracker lives at the same address.
+// Array and nothrow forms call these by default, aligned ones are not counted.
+struct AllocationHeader
+{
+	size_t size;
+	// 0 when no tracker counted the block
+	uint64_t generation;
+};
+
+static constexpr size_t HeaderSize = alignof(std::max_align_t) > sizeof(AllocationHeader) ? alignof(std::max_align_t) : sizeof(AllocationHeader);
+
+void* operator new(std::size_t size)
+{
+	void* block = std::malloc(size + HeaderSize);
+	if (!block)
+		throw std::bad_alloc();
+
+	auto* header = (AllocationHeader*)block;
+	header->size = size;
+	header->generation = activeTracker ? activeTracker->GetGeneration() : 0;
+	if (activeTracker)
+		activeTracker->OnAllocate(size, activeCategory);
+
+	return (char*)block + HeaderSize;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	if (!ptr)
+		return;
+
+	auto* header = (AllocationHeader*)((char*)ptr - HeaderSize);
+	if (header->generation != 0 && activeTracker && header->generation == activeTracker->GetGeneration())
+		activeTracker->OnFree(header->size);
+
+	std::free(header);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	operator delete(ptr);
+}
+
+#endif
\ No newline at end of file
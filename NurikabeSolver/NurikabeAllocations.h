@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Tracking allocations replaces the global operator new and delete of the
+// whole program, so it is only compiled in on request. Otherwise scopes leave
+// no trace and trackers never count anything.
+#ifndef NURIKABE_ALLOCATIONS
+#define NURIKABE_ALLOCATIONS 0
+#endif
+
+#if NURIKABE_ALLOCATIONS
+#define TRACK_ALLOCATIONS(category) Nurikabe::AllocationScope allocationScope(category)
+#else
+#define TRACK_ALLOCATIONS(category) do { } while (false)
+#endif
+
+namespace Nurikabe
+{
+	// where an allocation was made, the innermost TRACK_ALLOCATIONS decides
+	enum class AllocationCategory
+	{
+		Other,
+		// building regions within rules
+		Region,
+		// boards copied, also those of copied solvers
+		BoardCopy,
+		// solvers copied to guess and restored afterwards, except their boards
+		SolverCopy,
+		// solvers pushed onto the stack of guesses still to try
+		SolverStack,
+		Count
+	};
+
+	struct AllocationStats
+	{
+		struct Counters
+		{
+			uint64_t count = 0;
+			uint64_t bytes = 0;
+		};
+
+		Counters categories[(int)AllocationCategory::Count];
+		// most bytes allocated and not yet freed at once, memory from before tracking started is not included
+		int64_t peakLiveBytes = 0;
+
+		uint64_t GetCount() const;
+		uint64_t GetBytes() const;
+
+		/// @brief Writes totals and every category on one line.
+		void Print(std::ostream& stream) const;
+	};
+
+	// Counts allocations of the calling thread during its lifetime. Trackers
+	// can be nested, only the innermost one counts.
+	class AllocationTracker
+	{
+		AllocationStats stats;
+		int64_t liveBytes;
+		AllocationTracker* previous;
+		// never 0 and unique to this tracker, unlike its address that a later tracker can reuse
+		uint64_t generation;
+
+	public:
+		// false when NURIKABE_ALLOCATIONS is not set, no allocation is counted then
+		static constexpr bool IsAvailable = NURIKABE_ALLOCATIONS != 0;
+
+		AllocationTracker();
+		~AllocationTracker();
+
+		AllocationTracker(const AllocationTracker&) = delete;
+		AllocationTracker& operator=(const AllocationTracker&) = delete;
+
+		const AllocationStats& GetStats() const { return stats; }
+		uint64_t GetGeneration() const { return generation; }
+
+		/// @brief Called by operator new and delete for the tracker of their thread.
+		void OnAllocate(size_t size, AllocationCategory category);
+		void OnFree(size_t size);
+	};
+
+	// Attributes allocations of the calling thread to @p category while it
+	// exists. Use TRACK_ALLOCATIONS.
+	class AllocationScope
+	{
+		AllocationCategory previous;
+
+	public:
+		explicit AllocationScope(AllocationCategory category);
+		~AllocationScope();
+
+		AllocationScope(const AllocationScope&) = delete;
+		AllocationScope& operator=(const AllocationScope&) = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,314 @@
+// Microbenchmarks of the building blocks of the solver, run on boards captured
+// while solving real puzzles. Every benchmark goes over all captured boards as
+// many times as fits into the minimum time, one operation per board.
+// Usage: NurikabeBench [--min-time <ms>] [--filter <text>] [--json <file>] -f <filename1> [filename2] ...
+
+#include "Nurikabe.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+// every allocation of the process is counted, including those made inside the solver
+static uint64_t allocationCount = 0;
+
+// the library replaces operator new itself when it tracks allocations, see Measure
+#if !NURIKABE_ALLOCATIONS
+void* operator new(std::size_t size)
+{
+	allocationCount++;
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+#endif
+
+// results are added here, so the compiler cannot drop the work producing them
+static volatile int sink = 0;
+
+static void Keep(int value)
+{
+	sink = sink + value;
+}
+
+// Keeps a copy of the board after every few changes made by the rules.
+class BoardCollector : public Nurikabe::Observer
+{
+	std::vector<Nurikabe::Board>& boards;
+	int frequency;
+	int changeCount = 0;
+
+public:
+	BoardCollector(std::vector<Nurikabe::Board>& boards, int frequency)
+		: boards(boards)
+		, frequency(frequency)
+	{
+	}
+
+	void OnPhaseEnd(const Nurikabe::Solver& solver, int phase, bool hasChanged, bool isValid) override
+	{
+		if (hasChanged && isValid && ++changeCount % frequency == 0)
+			boards.push_back(solver.GetBoard());
+	}
+};
+
+// A captured board together with what the benchmarks work on. Regions point
+// to the board, so states are never moved once created.
+struct State
+{
+	Nurikabe::Board board;
+	Nurikabe::Board copy;
+	std::vector<Point> clues;
+	Nurikabe::Region whites;
+	Nurikabe::Region notBlacks;
+
+	int iteration = 0;
+	Nurikabe::Solver solver;
+
+	explicit State(const Nurikabe::Board& captured)
+		: board(captured)
+		, copy(captured)
+		, solver(captured, &iteration)
+	{
+		whites = Nurikabe::Region(&board);
+		notBlacks = Nurikabe::Region(&board);
+
+		board.ForEachSquare([this](const Point& pt, const Nurikabe::Square& sq)
+		{
+			if (sq.GetSize() != 0)
+				clues.push_back(pt);
+			if (sq.GetState() == Nurikabe::SquareState::White)
+				whites.Append(Nurikabe::Region(&board, pt));
+			if (sq.GetState() != Nurikabe::SquareState::Black)
+				notBlacks.Append(Nurikabe::Region(&board, pt));
+			return true;
+		});
+	}
+};
+
+struct Benchmark
+{
+	const char* name;
+	std::function<void(State&)> run;
+};
+
+struct Measurement
+{
+	std::string name;
+	uint64_t operations = 0;
+	double nanosecondsPerOperation = 0.0;
+	double allocationsPerOperation = 0.0;
+};
+
+static Measurement Measure(const Benchmark& benchmark, std::vector<std::unique_ptr<State>>& states, double minTimeMs)
+{
+	using Clock = std::chrono::steady_clock;
+
+	// one pass to warm up caches and the allocator
+	for (auto& state : states)
+		benchmark.run(*state);
+
+	Measurement measurement;
+	measurement.name = benchmark.name;
+
+#if NURIKABE_ALLOCATIONS
+	Nurikabe::AllocationTracker tracker;
+#endif
+
+	uint64_t allocationsStart = allocationCount;
+	auto start = Clock::now();
+	double elapsedMs = 0.0;
+	do
+	{
+		for (auto& state : states)
+			benchmark.run(*state);
+
+		measurement.operations += states.size();
+		elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	} while (elapsedMs < minTimeMs);
+
+	measurement.nanosecondsPerOperation = elapsedMs * 1e6 / measurement.operations;
+#if NURIKABE_ALLOCATIONS
+	allocationCount += tracker.GetStats().GetCount();
+#endif
+	measurement.allocationsPerOperation = (double)(allocationCount - allocationsStart) / measurement.operations;
+	return measurement;
+}
+
+static bool CaptureStates(const char* filename, std::vector<std::unique_ptr<State>>& states)
+{
+	Nurikabe::PackReader pack;
+	Nurikabe::Corpus corpus;
+	bool isPack = pack.Open(filename);
+	if (!isPack && !corpus.Open(filename))
+		return false;
+
+	int count = isPack ? pack.GetCount() : corpus.GetCount();
+	for (int i = 0; i < count; i++)
+	{
+		Nurikabe::Board board;
+		if (isPack ? !pack.Read(i, board) : !corpus.Load(i, board))
+			return false;
+
+		std::vector<Nurikabe::Board> boards;
+		BoardCollector collector(boards, 5);
+
+		Nurikabe::Solver::SolveSettings settings;
+		settings.maxDepth = 2;
+		settings.stopAtIteration = 1000;
+
+		int iteration = 0;
+		Nurikabe::Solver solver(board, &iteration);
+		solver.SetObserver(&collector);
+		solver.Solve(settings);
+
+		for (const auto& captured : boards)
+			states.push_back(std::make_unique<State>(captured));
+	}
+
+	return true;
+}
+
+static void WriteJson(std::ostream& stream, const std::vector<Measurement>& measurements, size_t stateCount)
+{
+	std::string out = "{\"states\":" + std::to_string(stateCount) + ",\"benchmarks\":[";
+	for (size_t i = 0; i < measurements.size(); i++)
+	{
+		const auto& measurement = measurements[i];
+		if (i > 0)
+			out += ",";
+
+		out += "{\"name\":";
+		Nurikabe::AppendJsonString(out, measurement.name);
+		out += ",\"operations\":" + std::to_string(measurement.operations);
+		out += ",\"nsPerOp\":" + std::to_string(measurement.nanosecondsPerOperation);
+		out += ",\"allocationsPerOp\":" + std::to_string(measurement.allocationsPerOperation) + "}";
+	}
+	out += "]}\n";
+	stream.write(out.data(), out.size());
+}
+
+int main(int argc, const char** argv)
+{
+	using namespace Nurikabe;
+
+	double minTimeMs = 200.0;
+	const char* filter = nullptr;
+	const char* jsonFilename = nullptr;
+	std::vector<const char*> filenames;
+
+	bool isFilename = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (isFilename)
+		{
+			filenames.push_back(argv[i]);
+			continue;
+		}
+
+		if (!std::strcmp(argv[i], "--min-time") && i + 1 < argc)
+			minTimeMs = std::atof(argv[++i]);
+		else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc)
+			filter = argv[++i];
+		else if (!std::strcmp(argv[i], "--json") && i + 1 < argc)
+			jsonFilename = argv[++i];
+		else if (!std::strcmp(argv[i], "-f"))
+			isFilename = true;
+	}
+
+	if (filenames.empty())
+	{
+		std::cout << "Usage: NurikabeBench [--min-time <ms>] [--filter <text>] [--json <file>] -f <filename1> [filename2] ..." << '\n';
+		return 0;
+	}
+
+#if !NURIKABE_OBSERVERS
+	std::cout << "Boards are captured by an observer, which this build of the solver does not support" << '\n';
+	return 1;
+#endif
+
+	std::vector<std::unique_ptr<State>> states;
+	for (const char* filename : filenames)
+	{
+		if (!CaptureStates(filename, states))
+		{
+			std::cout << "Failed to read '" << filename << "'" << '\n';
+			return 1;
+		}
+	}
+
+	if (states.empty())
+	{
+		std::cout << "No boards were captured, the puzzles are solved too quickly" << '\n';
+		return 1;
+	}
+
+	auto IsNotBlack = [](const Point&, const Square& sq) { return sq.GetState() != SquareState::Black; };
+
+	const std::vector<Benchmark> benchmarks =
+	{
+		{ "Board copy", [](State& state) { Board copy(state.board); Keep(copy.GetWidth()); } },
+		{ "Board compare", [](State& state) { Keep(state.board == state.copy); } },
+		{ "Rules::ContainsBlack2x2", [](State& state) { Keep(Rules::ContainsBlack2x2(state.board)); } },
+		{ "Region::Neighbours", [](State& state) { Keep(state.whites.Neighbours(SquareState::Unknown).GetSquareCount()); } },
+		{ "Region::ExpandAllInline", [IsNotBlack](State& state)
+			{
+				for (const auto& clue : state.clues)
+					Keep(Region(&state.board, clue).ExpandAllInline(IsNotBlack).GetSquareCount());
+			} },
+		{ "Region::Union", [](State& state) { Keep(Region::Union(state.whites, state.notBlacks).GetSquareCount()); } },
+		{ "Region::Intersection", [](State& state) { Keep(Region::Intersection(state.whites, state.notBlacks).GetSquareCount()); } },
+		{ "Region::Subtract", [](State& state) { Keep(Region::Subtract(state.notBlacks, state.whites).GetSquareCount()); } },
+		{ "Region::ForEachContiguousRegion", [](State& state)
+			{
+				state.notBlacks.ForEachContiguousRegion([](const Region& region) { Keep(region.GetSquareCount()); return true; });
+			} },
+		{ "Solver::UpdateContiguousRegions", [](State& state) { state.solver.UpdateContiguousRegions(); Keep(state.iteration); } },
+	};
+
+	std::cout << "Captured " << states.size() << " boards" << '\n';
+
+	std::vector<Measurement> measurements;
+	for (const auto& benchmark : benchmarks)
+	{
+		if (filter && !std::strstr(benchmark.name, filter))
+			continue;
+
+		auto measurement = Measure(benchmark, states, minTimeMs);
+		measurements.push_back(measurement);
+
+		char line[256];
+		std::snprintf(line, sizeof(line), "%-34s %12.1f ns/op %10.2f allocs/op %10llu ops\n",
+			measurement.name.c_str(), measurement.nanosecondsPerOperation, measurement.allocationsPerOperation, (unsigned long long)measurement.operations);
+		std::cout << line;
+	}
+
+	if (jsonFilename)
+	{
+		std::ofstream stream(jsonFilename, std::ios::binary);
+		WriteJson(stream, measurements, states.size());
+		if (!stream)
+		{
+			std::cout << "Failed to write '" << jsonFilename << "'" << '\n';
+			return 1;
+		}
+	}
+
+	return 0;
+}
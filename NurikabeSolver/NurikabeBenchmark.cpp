@@ -0,0 +1,236 @@
+#include "NurikabeBenchmark.h"
+#include "NurikabeDifficulty.h"
+#include "NurikabeJson.h"
+#include "NurikabeMappedFile.h"
+#include "NurikabeObserver.h"
+#include "NurikabeRequest.h"
+#include <algorithm>
+#include <cstdio>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace Nurikabe;
+
+namespace
+{
+	// smaller differences of the median are within what a busy machine varies by
+	const double minRegressionMs = 0.1;
+
+	class NodeCounter : public Observer
+	{
+	public:
+		int branchCount = 0;
+
+		void OnBranch(const Solver& solver, const Solver& branch, const Point& pt, SquareState state) override
+		{
+			branchCount++;
+		}
+	};
+
+	// Peak memory of the process is only known since it started, unless the peak can be reset,
+	// which Linux allows through clear_refs.
+	bool ResetPeakMemory()
+	{
+#ifdef __linux__
+#ifdef __GLIBC__
+		// memory freed by earlier puzzles would be reused without the resident size growing
+		malloc_trim(0);
+#endif
+
+		std::FILE* file = std::fopen("/proc/self/clear_refs", "w");
+		if (!file)
+			return false;
+
+		bool isReset = std::fputs("5", file) >= 0;
+		return std::fclose(file) == 0 && isReset;
+#else
+		return false;
+#endif
+	}
+
+	// resident memory of the process and its peak since the last reset, in kilobytes
+	bool GetMemoryKb(long long& current, long long& peak)
+	{
+#ifdef __linux__
+		std::FILE* file = std::fopen("/proc/self/status", "r");
+		if (!file)
+			return false;
+
+		int found = 0;
+		char line[256];
+		while (found < 2 && std::fgets(line, sizeof(line), file))
+		{
+			if (std::sscanf(line, "VmHWM: %lld", &peak) == 1 || std::sscanf(line, "VmRSS: %lld", &current) == 1)
+				found++;
+		}
+		std::fclose(file);
+		return found == 2;
+#else
+		return false;
+#endif
+	}
+
+	// nearest rank, so every value is one that was measured
+	double GetPercentile(const std::vector<double>& sorted, double percentile)
+	{
+		size_t rank = (size_t)(percentile * sorted.size() + 0.999999);
+		return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+	}
+}
+
+void BenchmarkResult::Write(std::string& out) const
+{
+	// left out rather than written as 0 when it was not measured
+	char solveBytes[48] = "";
+	if (peakSolveBytes >= 0)
+		std::snprintf(solveBytes, sizeof(solveBytes), ", \"peakSolveBytes\": %lld", peakSolveBytes);
+
+	char numbers[320];
+	std::snprintf(numbers, sizeof(numbers), ", \"runs\": %d, \"medianMs\": %.3f, \"p95Ms\": %.3f, \"iterations\": %d, \"nodes\": %d, \"peakMemoryKb\": %lld, \"squares\": %d%s, \"estimatedCost\": %.0f}\n",
+		runs, medianMs, p95Ms, iterations, nodes, peakMemoryKb, squares, solveBytes, estimatedCost);
+
+	out += "{\"name\": ";
+	AppendJsonString(out, name);
+	out += isSolved ? ", \"status\": \"solved\"" : ", \"status\": \"unsolved\"";
+	out += numbers;
+}
+
+bool BenchmarkResult::Parse(std::string_view line)
+{
+	JsonReader reader{ line };
+	if (!reader.Consume('{'))
+		return false;
+
+	bool hasName = false;
+	bool isFirst = true;
+	while (!reader.Consume('}'))
+	{
+		if (!isFirst && !reader.Consume(','))
+			return false;
+		isFirst = false;
+
+		std::string key;
+		if (!reader.ReadString(key) || !reader.Consume(':'))
+			return false;
+
+		if (key == "name" || key == "status")
+		{
+			std::string value;
+			if (!reader.ReadString(value))
+				return false;
+
+			if (key == "name")
+			{
+				name = value;
+				hasName = true;
+			}
+			else
+				isSolved = value == "solved";
+			continue;
+		}
+
+		std::string_view raw;
+		if (!reader.ReadRaw(raw))
+			return false;
+
+		// unknown members are ignored, so older results stay readable
+		std::string value(raw);
+		if (key == "runs")
+			std::sscanf(value.c_str(), "%d", &runs);
+		else if (key == "medianMs")
+			std::sscanf(value.c_str(), "%lf", &medianMs);
+		else if (key == "p95Ms")
+			std::sscanf(value.c_str(), "%lf", &p95Ms);
+		else if (key == "iterations")
+			std::sscanf(value.c_str(), "%d", &iterations);
+		else if (key == "nodes")
+			std::sscanf(value.c_str(), "%d", &nodes);
+		else if (key == "peakMemoryKb")
+			std::sscanf(value.c_str(), "%lld", &peakMemoryKb);
+		else if (key == "squares")
+			std::sscanf(value.c_str(), "%d", &squares);
+		else if (key == "peakSolveBytes")
+			std::sscanf(value.c_str(), "%lld", &peakSolveBytes);
+		else if (key == "estimatedCost")
+			std::sscanf(value.c_str(), "%lf", &estimatedCost);
+	}
+
+	return hasName;
+}
+
+BenchmarkResult Nurikabe::RunBenchmark(const std::string& name, const Board& puzzle, const Solver::SolveSettings& solveSettings, const BenchmarkSettings& settings)
+{
+	BenchmarkResult result;
+	result.name = name;
+	result.isSolved = true;
+	result.squares = puzzle.GetWidth() * puzzle.GetHeight();
+	result.estimatedCost = EstimateDifficulty(puzzle).cost;
+
+	// only what solving adds to the memory of the process counts
+	long long startMemoryKb = 0;
+	long long peakMemoryKb = 0;
+	const bool isPeakMemoryReset = ResetPeakMemory() && GetMemoryKb(startMemoryKb, peakMemoryKb);
+
+	for (int i = 0; i < settings.warmupRuns; i++)
+		SolveBoard(puzzle, solveSettings);
+
+	std::vector<double> runtimes;
+	for (int i = 0; i < std::max(settings.runs, 1); i++)
+	{
+		NodeCounter counter;
+		auto run = SolveBoard(puzzle, solveSettings, nullptr, &counter);
+
+		// the solver is deterministic, every run takes the same path
+		result.isSolved = result.isSolved && run.status == Result::Status::Solved;
+		result.iterations = run.iterations;
+		result.nodes = counter.branchCount + 1;
+		result.peakSolveBytes = AllocationTracker::IsAvailable ? run.allocations.peakLiveBytes : -1;
+		runtimes.push_back(run.runtimeMs);
+	}
+
+	std::sort(runtimes.begin(), runtimes.end());
+	result.runs = (int)runtimes.size();
+	result.medianMs = runtimes.size() % 2 ? runtimes[runtimes.size() / 2] : (runtimes[runtimes.size() / 2 - 1] + runtimes[runtimes.size() / 2]) / 2;
+	result.p95Ms = GetPercentile(runtimes, 0.95);
+	long long currentMemoryKb = 0;
+	if (isPeakMemoryReset && GetMemoryKb(currentMemoryKb, peakMemoryKb))
+		result.peakMemoryKb = std::max(peakMemoryKb - startMemoryKb, 0ll);
+
+	return result;
+}
+
+bool Nurikabe::ReadBenchmarkResults(const char* filename, std::vector<BenchmarkResult>& results)
+{
+	MappedFile file;
+	if (!file.Open(filename))
+		return false;
+
+	std::string_view text(file.GetData(), file.GetSize());
+	while (!text.empty())
+	{
+		size_t end = text.find('\n');
+		std::string_view line = text.substr(0, end);
+		text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+		if (line.find_first_not_of(" \t\r") == std::string_view::npos)
+			continue;
+
+		BenchmarkResult result;
+		if (!result.Parse(line))
+			return false;
+		results.push_back(result);
+	}
+
+	return true;
+}
+
+bool Nurikabe::IsBenchmarkRegression(const BenchmarkResult& result, const BenchmarkResult& baseline, double threshold)
+{
+	if (baseline.isSolved && !result.isSolved)
+		return true;
+
+	double slowdownMs = result.medianMs - baseline.medianMs;
+	return slowdownMs > minRegressionMs && slowdownMs > baseline.medianMs * threshold;
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+#include "NurikabeBoard.h"
+#include "NurikabeSolver.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Nurikabe
+{
+	// Timing of a puzzle solved several times, written as one JSON object per line:
+	//   {"name": "10x10-1.txt", "status": "solved", "runs": 5, "medianMs": 1.25, "p95Ms": 1.4,
+	//    "iterations": 52, "nodes": 3, "peakMemoryKb": 5120, "squares": 100, "peakSolveBytes": 81920,
+	//    "estimatedCost": 13400}
+	// `nodes` counts the solvers of the search tree, 1 when nothing had to be guessed.
+	// `peakMemoryKb` is how far resident memory of the process rose while the puzzle was
+	// solved, which is only known on Linux and 0 elsewhere.
+	// `peakSolveBytes` is the most memory a single solve of the puzzle allocated at once,
+	// only measured when built with NURIKABE_ALLOCATIONS and left out otherwise. Together with `squares` it shows
+	// how solving scales with the size of the board. `estimatedCost` is the cost
+	// EstimateDifficulty expected before solving, to compare against the runtime.
+	struct BenchmarkResult
+	{
+		std::string name;
+		bool isSolved = false;
+		int runs = 0;
+		double medianMs = 0.0;
+		double p95Ms = 0.0;
+		int iterations = 0;
+		int nodes = 0;
+		long long peakMemoryKb = 0;
+		int squares = 0;
+		// -1 when not measured
+		long long peakSolveBytes = -1;
+		double estimatedCost = 0.0;
+
+		void Write(std::string& out) const;
+
+		/// @brief Parses a line written by Write, members other than the name are optional.
+		bool Parse(std::string_view line);
+	};
+
+	struct BenchmarkSettings
+	{
+		int runs = 5;
+		// runs before the measured ones, which warm up caches and the allocator
+		int warmupRuns = 1;
+	};
+
+	/// @brief Solves @p puzzle as many times as @p settings asks and measures the runs.
+	BenchmarkResult RunBenchmark(const std::string& name, const Board& puzzle, const Solver::SolveSettings& solveSettings, const BenchmarkSettings& settings);
+
+	/// @brief Reads results from a file of Write lines, such as the output of an earlier run.
+	bool ReadBenchmarkResults(const char* filename, std::vector<BenchmarkResult>& results);
+
+	/// @brief True when @p result is more than @p threshold (0.1 for 10%) slower than @p baseline , or no longer solved. Differences below 0.1 ms are noise and ignored.
+	bool IsBenchmarkRegression(const BenchmarkResult& result, const BenchmarkResult& baseline, double threshold);
+}
\ No newline at end of file
@@ -2,7 +2,8 @@
 //
 
 #include "NurikabeBoard.h"
-#include <fstream>
+#include "NurikabeAllocations.h"
+#include "NurikabeCorpus.h"
 #include <cstring>
 #include <utility>
 
@@ -16,12 +17,24 @@ Board::Board()
 {
 }
 
+Board::Board(int width, int height)
+	: squares(new Square[width * height])
+	, width(width)
+	, height(height)
+	, iteration(0)
+{
+}
+
 Board::Board(const Board& other)
-	: squares(new Square[other.GetWidth() * other.GetHeight()])
+	: squares(nullptr)
 	, width(other.width)
 	, height(other.height)
 	, iteration(other.iteration)
+	, changedSquares(other.changedSquares)
 {
+	TRACK_ALLOCATIONS(AllocationCategory::BoardCopy);
+
+	squares = new Square[width * height];
 	std::memcpy(squares, other.squares, sizeof(Square) * width * height);
 }
 
@@ -30,6 +43,7 @@ Board::Board(Board&& other)
 	, width(other.width)
 	, height(other.height)
 	, iteration(other.iteration)
+	, changedSquares(std::move(other.changedSquares))
 {
 	
 }
@@ -45,15 +59,21 @@ Board::~Board()
 
 Board& Board::operator=(const Board& other)
 {
+	if (this == &other)
+		return *this;
+
+	TRACK_ALLOCATIONS(AllocationCategory::BoardCopy);
+
 	if (squares)
 		delete[] squares;
 
-	squares = new Square[other.GetWidth() * other.GetHeight()];
-	std::memcpy(squares, other.squares, sizeof(Square) * width * height);
-
 	width = other.width;
 	height = other.height;
 	iteration = other.iteration;
+	changedSquares = other.changedSquares;
+
+	squares = new Square[width * height];
+	std::memcpy(squares, other.squares, sizeof(Square) * width * height);
 
 	return *this;
 }
@@ -64,6 +84,7 @@ Board& Board::operator=(Board&& other)
 	width = std::exchange(other.width, width);
 	height = std::exchange(other.height, height);
 	iteration = std::exchange(other.iteration, iteration);
+	changedSquares.swap(other.changedSquares);
 
 	return *this;
 }
@@ -84,100 +105,178 @@ bool Board::operator==(const Board& other) const
 
 bool Board::Load(const char* filename)
 {
-	std::ifstream stream(filename, std::ios::binary);
-	if (!stream.is_open())
+	// a puzzle file is a corpus with a single puzzle
+	Corpus corpus;
+	if (!corpus.Open(filename) || corpus.GetCount() < 1)
 		return false;
 
-	int boardSize = 10000;
-	Square* squares = new Square[boardSize];
-	memset(squares, 0, boardSize * sizeof(*squares));
-	int x = 0;
-	int y = 0;
-	char val;
+	return corpus.Load(0, *this);
+}
 
-	// read byte by byte
-	// boards arent that big, so this shouldn't be a problem
-	while (stream.read(&val, sizeof(val)))
-	{
-		if (val == '|' || val == '-' || val == '+')
-		{
-			// we let the file contain these symbols to mark
-			// edges of the board, ignore character
-			continue;
-		}
+bool Board::Load(const char* data, size_t size)
+{
+	// we let the text contain these symbols to mark edges of the board
+	auto IsEdge = [](char val) { return val == '|' || val == '-' || val == '+'; };
+	auto IsEndOfLine = [](char val) { return val == '\r' || val == '\n'; };
 
-		if (val == '\r' || val == '\n')
+	// a square is a single character, except for clues of any size written as
+	// digits in parentheses, like "(120)"
+	auto ParseSquare = [data, size](size_t& i, Square& square)
+	{
+		char val = data[i++];
+		if (val == '(')
 		{
-			// detected end of line
-
-			// if x = 0 then the line is empty, we can ignore those
-			if (x == 0)
-				continue;
-
-			if (width != 0)
+			int value = 0;
+			size_t start = i;
+			for (; i < size && data[i] >= '0' && data[i] <= '9'; i++)
 			{
-				if (width != x)
-				{
-					// width is not the same on every line in the file
-					delete[] squares;
+				value = value * 10 + data[i] - '0';
+				if (value > MaxSquareValue)
 					return false;
-				}
 			}
 
-			// here we are either at the first end of line
-			// or the line matched the length of previous lines
-			width = x;
-			x = 0;
-
-			// move to next line
-			y++;
-
-			// we don't want to increment x
-			continue;
-		}
+			if (i == start || i == size || data[i] != ')' || value == 0)
+				return false;
 
-		if (val == ' ' || val == '_')
-		{
-			// square is white
-			squares[y * width + x] = Square(SquareState::Unknown, 0);
+			i++;
+			square = Square(SquareState::White, (SquareValue)value);
 		}
 		else if (val >= '1' && val <= '9')
 		{
 			// parse digits
-			squares[y * width + x] = Square(SquareState::White, val - '0');
+			square = Square(SquareState::White, val - '0');
 		}
 		else if (val >= 'a' && val <= 'z')
 		{
 			// parse higher numbers, represented by letters
-			squares[y * width + x] = Square(SquareState::White, val - 'a' + 10);
+			square = Square(SquareState::White, val - 'a' + 10);
 		}
 		else if (val >= 'A' && val <= 'Z')
 		{
 			// parse higher numbers, represented by letters
-			squares[y * width + x] = Square(SquareState::White, val - 'A' + 10);
+			square = Square(SquareState::White, val - 'A' + 10);
 		}
 		else
 		{
-			// for any other square we have no clue what it is
-			squares[y * width + x] = Square(SquareState::Unknown, 0);
+			// ' ' and '_' are unknown squares, for any other square we have no clue what it is
+			square = Square(SquareState::Unknown, 0);
+		}
+		return true;
+	};
+
+	// first pass only measures the board, so squares can be parsed
+	// straight into a buffer of the right size
+	int newWidth = 0;
+	int newHeight = 0;
+	int x = 0;
+	for (size_t i = 0; ; )
+	{
+		if (i == size || IsEndOfLine(data[i]))
+		{
+			// if x = 0 then the line is empty, we can ignore those
+			if (x != 0)
+			{
+				// width has to be the same on every line
+				if (newWidth != 0 && newWidth != x)
+					return false;
+
+				newWidth = x;
+				newHeight++;
+				x = 0;
+			}
+
+			if (i == size)
+				break;
+
+			i++;
+			continue;
+		}
+
+		if (IsEdge(data[i]))
+		{
+			i++;
+			continue;
 		}
 
+		Square square;
+		if (!ParseSquare(i, square))
+			return false;
+
 		x++;
 	}
 
-	// if last character was newline, make sure to increment y
-	if (!(val == '\r' || val == '\n') && x == width)
-		y++;
+	if (newWidth == 0 || newHeight == 0)
+		return false;
+
+	Square* newSquares = new Square[newWidth * newHeight];
+	Square* square = newSquares;
+
+	// every clue needs an origin below NoOrigin
+	int clueCount = 0;
+
+	for (size_t i = 0; i < size; )
+	{
+		if (IsEdge(data[i]) || IsEndOfLine(data[i]))
+		{
+			i++;
+			continue;
+		}
+
+		ParseSquare(i, *square);
+		if (square->GetSize() != 0)
+			clueCount++;
 
-	// remember height
-	height = y;
+		square++;
+	}
+
+	if (clueCount >= NoOrigin)
+	{
+		delete[] newSquares;
+		return false;
+	}
 
 	// give ownership of "board" to class
-	this->squares = squares;
+	delete[] squares;
+	squares = newSquares;
+	width = newWidth;
+	height = newHeight;
+	iteration = 0;
+	changedSquares.clear();
 
 	return true;
 }
 
+void Board::Save(std::string& out) const
+{
+	// clues only, with the edges drawn the way puzzle files usually have them
+	std::string edge = "+";
+	edge.append(width, '-');
+	edge += "+\n";
+	out += edge;
+	for (int y = 0; y < height; y++)
+	{
+		out.push_back('|');
+		for (int x = 0; x < width; x++)
+		{
+			int size = GetRequiredSize({ x, y });
+			if (size == 0)
+				out.push_back(' ');
+			else if (size < 10)
+				out.push_back('0' + size);
+			else if (size < 36)
+				out.push_back('a' + size - 10);
+			else
+			{
+				out.push_back('(');
+				out += std::to_string(size);
+				out.push_back(')');
+			}
+		}
+		out += "|\n";
+	}
+	out += edge;
+}
+
 bool Board::IsLoaded() const
 {
 	return squares != nullptr;
@@ -237,6 +336,7 @@ void Board::SetWhite(const Point& pt)
 	if (!IsValidPosition(pt))
 		return;
 	GetInternal(pt).SetState(SquareState::White);
+	MarkChanged(pt);
 	iteration++;
 }
 void Board::SetBlack(const Point& pt)
@@ -244,6 +344,7 @@ void Board::SetBlack(const Point& pt)
 	if (!IsValidPosition(pt))
 		return;
 	GetInternal(pt).SetState(SquareState::Black);
+	MarkChanged(pt);
 	iteration++;
 }
 void Board::SetSize(const Point& pt, int size)
@@ -251,6 +352,7 @@ void Board::SetSize(const Point& pt, int size)
 	if (!IsValidPosition(pt))
 		return;
 	GetInternal(pt).SetSize(size);
+	MarkChanged(pt);
 	iteration++;
 }
 void Board::SetOrigin(const Point& pt, int origin)
@@ -258,9 +360,35 @@ void Board::SetOrigin(const Point& pt, int origin)
 	if (!IsValidPosition(pt))
 		return;
 	GetInternal(pt).SetOrigin(origin);
+	MarkChanged(pt);
 	iteration++;
 }
 
+void Board::TakeChangedSquares(std::vector<int>& changed)
+{
+	changed.clear();
+	changed.swap(changedSquares);
+}
+
+void Board::MarkAllChanged()
+{
+	changedSquares.resize(width * height);
+	for (int i = 0; i < width * height; i++)
+		changedSquares[i] = i;
+}
+
+void Board::MarkChanged(const Point& pt)
+{
+	// once the list is as long as the board it lists every square, repeats are turned into that early
+	const int squareCount = width * height;
+	if ((int)changedSquares.size() >= squareCount)
+		return;
+
+	changedSquares.push_back(pt.y * width + pt.x);
+	if ((int)changedSquares.size() == squareCount)
+		MarkAllChanged();
+}
+
 
 void Board::ForEachSquare(const PointSquareDelegate& callback) const
 {
@@ -281,7 +409,22 @@ void Board::Print(std::ostream& stream) const
 	Board::Print(pThis, 1, stream);
 }
 
+void Board::Print(std::string& out) const
+{
+	const Board* pThis[] = { this };
+	Board::Print(pThis, 1, out);
+}
+
 void Board::Print(const Board** boards, int boardCount, std::ostream& stream)
+{
+	std::string out;
+	Board::Print(boards, boardCount, out);
+
+	// whole boards at once, instead of flushing every row
+	stream.write(out.data(), out.size());
+}
+
+void Board::Print(const Board** boards, int boardCount, std::string& out)
 {
 	// We start with drawing 2 lines of stuff above board content
 	int row = -2;
@@ -293,7 +436,7 @@ void Board::Print(const Board** boards, int boardCount, std::ostream& stream)
 		{
 			// Draw some space between boards
 			if (bi > 0)
-				stream << ' ';
+				out.push_back(' ');
 
 			const auto* pBoard = boards[bi];
 			if (pBoard == nullptr)
@@ -303,34 +446,34 @@ void Board::Print(const Board** boards, int boardCount, std::ostream& stream)
 			if (row == -2)
 			{
 				// Draw X-Axis numbers [0-9]
-				stream.put(' ');
-				stream.put(' ');
-				stream.put(' ');
+				out.push_back(' ');
+				out.push_back(' ');
+				out.push_back(' ');
 				for (int x = 0; x < board.width; x++)
 				{
-					stream << x % 10;
+					out.push_back('0' + x % 10);
 					if (x < board.width - 1)
-						stream.put(' ');
+						out.push_back(' ');
 
 					// find max board height
 					if (board.height > maxHeight)
 						maxHeight = board.height;
 				}
-				stream.put(' ');
+				out.push_back(' ');
 			}
 			else if (row == -1 || row == board.height)
 			{
 				// Draw top or bottom border
-				stream.put(' ');
-				stream.put(' ');
-				stream.put('+');
+				out.push_back(' ');
+				out.push_back(' ');
+				out.push_back('+');
 				for (int x = 0; x < board.width; x++)
 				{
-					stream.put('-');
+					out.push_back('-');
 					if (x < board.width - 1)
-						stream.put('-');
+						out.push_back('-');
 				}
-				stream.put('+');
+				out.push_back('+');
 			}
 			else
 			{
@@ -338,12 +481,11 @@ void Board::Print(const Board** boards, int boardCount, std::ostream& stream)
 
 				// Draw Y-Axis numbers [0-99]
 				int yMod = y % 100;
-				if (yMod < 10)
-					stream << ' ';
-				stream << yMod;
+				out.push_back(yMod < 10 ? ' ' : '0' + yMod / 10);
+				out.push_back('0' + yMod % 10);
 
 				// Draw left border
-				stream << '|';
+				out.push_back('|');
 
 				// Draw board row
 				for (int x = 0; x < board.width; x++)
@@ -352,42 +494,47 @@ void Board::Print(const Board** boards, int boardCount, std::ostream& stream)
 					switch (val.GetState())
 					{
 					case SquareState::Unknown:
-						stream.put('*');
+						out.push_back('*');
 						break;
 
 					case SquareState::Wall:
-						stream.put('+');
+						out.push_back('+');
 						break;
 
 					case SquareState::White:
 						if (val.GetSize() == 0)
 						{
-							stream.put('#');
+							out.push_back('#');
 						}
 						else if (val.GetSize() < 10)
 						{
-							stream.put(val.GetSize() + '0');
+							out.push_back(val.GetSize() + '0');
+						}
+						else if (val.GetSize() < 36)
+						{
+							out.push_back(val.GetSize() - 10 + 'a');
 						}
 						else
 						{
-							stream.put(val.GetSize() - 10 + 'a');
+							// there is no room for more than one character
+							out.push_back('>');
 						}
 						break;
 					case SquareState::Black:
-						stream.put(' ');
+						out.push_back(' ');
 						break;
 					}
 					if (x < board.width - 1)
-						stream.put(' ');
+						out.push_back(' ');
 				}
 
 				// Draw right border
-				stream.put('|');
+				out.push_back('|');
 			}
 		}
 
 		// Go to new line
-		stream << std::endl;
+		out.push_back('\n');
 
 		if (isLastRow)
 			break;
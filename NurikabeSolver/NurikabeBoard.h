@@ -2,8 +2,9 @@
 #include "NurikabeSquare.h"
 #include "Point.h"
 #include <ostream>
+#include <string>
 #include <functional>
-//#include <vector>
+#include <vector>
 
 namespace Nurikabe
 {
@@ -16,12 +17,21 @@ namespace Nurikabe
 		int height;
 		int iteration;
 
+		// squares set since TakeChangedSquares was last called, a square set twice is listed twice.
+		// Holding as many entries as the board has squares means every square is listed once
+		std::vector<int> changedSquares;
+
 	public:
 		int GetWidth() const { return width; }
 		int GetHeight() const { return height; }
 
+		// increases every time a square is modified
+		int GetIteration() const { return iteration; }
+
 	public:
 		Board();
+		// board of unknown squares
+		Board(int width, int height);
 		Board(const Board& other);
 		Board(Board&& other);
 		~Board();
@@ -32,6 +42,12 @@ namespace Nurikabe
 		bool operator==(const Board& other) const;
 	public:
 		bool Load(const char* filename);
+
+		// parses a puzzle from text, in the same format as puzzle files
+		bool Load(const char* data, size_t size);
+
+		// writes the clues in the format of puzzle files
+		void Save(std::string& out) const;
 		bool IsLoaded() const;
 	
 	private:
@@ -58,12 +74,24 @@ namespace Nurikabe
 		void SetSize(const Point& pt, int size);
 		void SetOrigin(const Point& pt, int origin);
 
+		/// @brief Moves the squares set since the last call into @p changed , as y * width + x. They can be set to what they were before, and listed more than once.
+		void TakeChangedSquares(std::vector<int>& changed);
+		/// @brief Lists every square as changed, for readers of TakeChangedSquares that have not seen the board before.
+		void MarkAllChanged();
+
+	private:
+		void MarkChanged(const Point& pt);
+
 	public:
 		void ForEachSquare(const PointSquareDelegate& callback) const;
 		//void ForEachSquare(const PointSquareConstDelegate& callback) const;
 
 		void Print(std::ostream& stream) const;
+		void Print(std::string& out) const;
+
+		// prints boards next to each other
 		static void Print(const Board** boards, int boardCount, std::ostream& stream);
+		static void Print(const Board** boards, int boardCount, std::string& out);
 
 		static bool Difference(Board& board, const Board& other, bool compareOrigin);
 	};
@@ -0,0 +1,130 @@
+#include "NurikabeC.h"
+#include "NurikabeSolver.h"
+#include <new>
+
+using namespace Nurikabe;
+
+struct nk_puzzle
+{
+	Board board;
+	Board solution;
+	int iterations = 0;
+};
+
+nk_settings nk_default_settings(void)
+{
+	nk_settings settings;
+	settings.max_depth = 2;
+	settings.stop_at_iteration = -1;
+	return settings;
+}
+
+nk_puzzle* nk_load_from_buffer(const char* data, size_t size)
+{
+	if (!data)
+		return nullptr;
+
+	auto* puzzle = new (std::nothrow) nk_puzzle;
+	if (!puzzle)
+		return nullptr;
+
+	// exceptions must not cross into C
+	bool isLoaded = false;
+	try
+	{
+		isLoaded = puzzle->board.Load(data, size);
+	}
+	catch (...)
+	{
+	}
+
+	if (!isLoaded)
+	{
+		delete puzzle;
+		return nullptr;
+	}
+
+	return puzzle;
+}
+
+int nk_get_width(const nk_puzzle* puzzle)
+{
+	return puzzle ? puzzle->board.GetWidth() : 0;
+}
+
+int nk_get_height(const nk_puzzle* puzzle)
+{
+	return puzzle ? puzzle->board.GetHeight() : 0;
+}
+
+nk_status nk_solve(nk_puzzle* puzzle, const nk_settings* settings, double deadline_ms)
+{
+	if (!puzzle)
+		return NK_INVALID_ARGUMENT;
+
+	nk_settings used = settings ? *settings : nk_default_settings();
+
+	Solver::SolveSettings solveSettings;
+	solveSettings.maxDepth = used.max_depth;
+	solveSettings.stopAtIteration = used.stop_at_iteration;
+	if (deadline_ms >= 0.0)
+	{
+		auto duration = std::chrono::duration<double, std::milli>(deadline_ms);
+		solveSettings.deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration);
+	}
+
+	puzzle->iterations = 0;
+	puzzle->solution = Board();
+
+	try
+	{
+		Solver solver(puzzle->board, &puzzle->iterations);
+		if (solver.Solve(solveSettings))
+		{
+			puzzle->solution = solver.GetBoard();
+			return NK_SOLVED;
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		// exceptions must not cross into C
+		puzzle->solution = Board();
+		return NK_OUT_OF_MEMORY;
+	}
+	catch (...)
+	{
+		puzzle->solution = Board();
+		return NK_INTERNAL_ERROR;
+	}
+
+	return solveSettings.IsPastDeadline() ? NK_DEADLINE_EXCEEDED : NK_UNSOLVED;
+}
+
+int nk_get_iterations(const nk_puzzle* puzzle)
+{
+	return puzzle ? puzzle->iterations : 0;
+}
+
+size_t nk_get_solution_mask(const nk_puzzle* puzzle, unsigned char* mask, size_t size)
+{
+	if (!puzzle || !puzzle->solution.IsLoaded())
+		return 0;
+
+	const int width = puzzle->solution.GetWidth();
+	const int height = puzzle->solution.GetHeight();
+	const size_t squareCount = (size_t)width * height;
+	if (!mask || size < squareCount)
+		return 0;
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+			mask[y * width + x] = puzzle->solution.IsBlack({ x, y }) ? 1 : 0;
+	}
+	return squareCount;
+}
+
+void nk_free(nk_puzzle* puzzle)
+{
+	delete puzzle;
+}
@@ -0,0 +1,75 @@
+#ifndef NURIKABE_C_H
+#define NURIKABE_C_H
+
+/*
+ * C interface of the solver, for embedding it into programs that are not
+ * written in C++. Functions do not allocate anything except for nk_load_from_buffer,
+ * which creates the puzzle, and nk_solve, which needs memory for the solver.
+ * A puzzle can be used by one thread at a time, different puzzles can be
+ * solved in parallel.
+ */
+
+#include <stddef.h>
+
+#if defined(_WIN32) && defined(NURIKABE_BUILDING_LIBRARY)
+#define NK_API __declspec(dllexport)
+#elif defined(_WIN32) && defined(NURIKABE_SHARED)
+#define NK_API __declspec(dllimport)
+#else
+#define NK_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct nk_puzzle nk_puzzle;
+
+typedef struct nk_settings
+{
+	/* how many guesses deep the solver may go, -1 for no limit */
+	int max_depth;
+	/* iteration to give up at, -1 for no limit */
+	int stop_at_iteration;
+} nk_settings;
+
+typedef enum nk_status
+{
+	NK_SOLVED = 0,
+	NK_UNSOLVED = 1,
+	NK_DEADLINE_EXCEEDED = 2,
+	NK_INVALID_ARGUMENT = -1,
+	NK_OUT_OF_MEMORY = -2,
+	/* the solver failed in a way it does not expect, the puzzle has no solution then */
+	NK_INTERNAL_ERROR = -3
+} nk_status;
+
+/* settings used by the command line tool */
+NK_API nk_settings nk_default_settings(void);
+
+/* parses a puzzle in the format of puzzle files, returns NULL when it is not valid */
+NK_API nk_puzzle* nk_load_from_buffer(const char* data, size_t size);
+
+NK_API int nk_get_width(const nk_puzzle* puzzle);
+NK_API int nk_get_height(const nk_puzzle* puzzle);
+
+/* solves the puzzle, giving up after deadline_ms milliseconds unless it is negative, settings can be NULL */
+NK_API nk_status nk_solve(nk_puzzle* puzzle, const nk_settings* settings, double deadline_ms);
+
+/* iterations the last nk_solve took */
+NK_API int nk_get_iterations(const nk_puzzle* puzzle);
+
+/*
+ * Writes one byte per square of the last solution, row by row, 1 for black
+ * and 0 for white. Returns the number of squares, which is also the size mask
+ * needs to have, or 0 when there is no solution or mask is too small.
+ */
+NK_API size_t nk_get_solution_mask(const nk_puzzle* puzzle, unsigned char* mask, size_t size);
+
+NK_API void nk_free(nk_puzzle* puzzle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
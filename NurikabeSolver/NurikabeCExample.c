@@ -0,0 +1,75 @@
+/*
+ * Solves a puzzle file through the C API and prints its solution.
+ * Usage: NurikabeCExample <filename>
+ */
+
+#include "NurikabeC.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: NurikabeCExample <filename>\n");
+		return 1;
+	}
+
+	FILE* file = fopen(argv[1], "rb");
+	if (!file)
+	{
+		printf("Failed to read '%s'\n", argv[1]);
+		return 1;
+	}
+
+	char data[64 * 1024];
+	size_t size = fread(data, 1, sizeof(data), file);
+	fclose(file);
+
+	nk_puzzle* puzzle = nk_load_from_buffer(data, size);
+	if (!puzzle)
+	{
+		printf("Failed to parse '%s'\n", argv[1]);
+		return 1;
+	}
+
+	/* a deadline that has passed already must stop the solver */
+	if (nk_solve(puzzle, NULL, 0.0) != NK_DEADLINE_EXCEEDED)
+	{
+		printf("Deadline was ignored\n");
+		nk_free(puzzle);
+		return 1;
+	}
+
+	nk_settings settings = nk_default_settings();
+	nk_status status = nk_solve(puzzle, &settings, 10000.0);
+	if (status != NK_SOLVED)
+	{
+		printf("Failed to solve, status %d\n", (int)status);
+		nk_free(puzzle);
+		return 1;
+	}
+
+	int width = nk_get_width(puzzle);
+	int height = nk_get_height(puzzle);
+	unsigned char* mask = malloc((size_t)width * height);
+	if (!mask || nk_get_solution_mask(puzzle, mask, (size_t)width * height) != (size_t)width * height)
+	{
+		printf("Failed to get the solution\n");
+		free(mask);
+		nk_free(puzzle);
+		return 1;
+	}
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+			putchar(mask[y * width + x] ? '#' : '.');
+		putchar('\n');
+	}
+	printf("Iterations: %d\n", nk_get_iterations(puzzle));
+
+	free(mask);
+	nk_free(puzzle);
+	return 0;
+}
@@ -0,0 +1,205 @@
+#include "NurikabeCorpus.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace Nurikabe;
+
+static const char indexMagic[4] = { 'N', 'K', 'C', 'X' };
+static const uint8_t indexVersion = 1;
+static const size_t indexHeaderSize = 32;
+static const size_t indexEntrySize = 32;
+
+static void AppendInteger(std::string& out, uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+		out.push_back((char)(value >> (8 * i)));
+}
+
+static uint64_t ReadInteger(const char* data)
+{
+	uint64_t value = 0;
+	for (int i = 0; i < 8; i++)
+		value |= (uint64_t)(uint8_t)data[i] << (8 * i);
+	return value;
+}
+
+Corpus::Corpus()
+	: entries(nullptr)
+	, count(0)
+{
+}
+
+bool Corpus::Open(const char* filename)
+{
+	Close();
+
+	// the index is only trusted for the corpus as it was when the index was written
+	std::error_code error;
+	int64_t writeTime = (int64_t)std::filesystem::last_write_time(filename, error).time_since_epoch().count();
+	if (error)
+		return false;
+
+	// puzzles are read front to back
+	if (!file.Open(filename, true))
+		return false;
+
+	const std::string indexFilename = std::string(filename) + ".idx";
+	if (OpenIndex(indexFilename, writeTime))
+		return true;
+
+	BuildIndex(writeTime);
+	if (count > 1)
+		WriteIndex(indexFilename);
+	return true;
+}
+
+void Corpus::Close()
+{
+	entries = nullptr;
+	count = 0;
+	builtIndex.clear();
+	indexFile.Close();
+	file.Close();
+}
+
+bool Corpus::OpenIndex(const std::string& indexFilename, int64_t writeTime)
+{
+	if (!indexFile.Open(indexFilename.c_str()))
+		return false;
+
+	const char* data = indexFile.GetData();
+	const size_t size = indexFile.GetSize();
+
+	bool isValid = size >= indexHeaderSize
+		&& std::memcmp(data, indexMagic, sizeof(indexMagic)) == 0
+		&& (uint8_t)data[4] == indexVersion
+		&& ReadInteger(data + 8) == file.GetSize()
+		&& (int64_t)ReadInteger(data + 16) == writeTime;
+
+	// an index cut short by a writer that did not finish has fewer entries than it says
+	const uint64_t entryCount = isValid ? ReadInteger(data + 24) : 0;
+	if (!isValid || entryCount > INT32_MAX || (size - indexHeaderSize) / indexEntrySize != entryCount || (size - indexHeaderSize) % indexEntrySize != 0)
+	{
+		indexFile.Close();
+		return false;
+	}
+
+	entries = data + indexHeaderSize;
+	count = (int)entryCount;
+	return true;
+}
+
+void Corpus::BuildIndex(int64_t writeTime)
+{
+	const char* data = file.GetData();
+	const size_t size = file.GetSize();
+
+	AppendInteger(builtIndex, 0);
+	AppendInteger(builtIndex, size);
+	AppendInteger(builtIndex, writeTime);
+	AppendInteger(builtIndex, 0);
+	std::memcpy(builtIndex.data(), indexMagic, sizeof(indexMagic));
+	builtIndex[4] = (char)indexVersion;
+
+	size_t nameStart = 0;
+	size_t nameEnd = 0;
+	size_t start = 0;
+	size_t lineStart = 0;
+
+	auto AddEntry = [this, data, &nameStart, &nameEnd](size_t from, size_t to)
+	{
+		// ignore text between separators that has no squares in it, like the
+		// space before the first separator
+		auto content = std::string_view(data + from, to - from);
+		if (content.find_first_not_of(" \t\r\n") == std::string_view::npos && nameStart == nameEnd)
+			return;
+
+		AppendInteger(builtIndex, nameStart);
+		AppendInteger(builtIndex, nameEnd - nameStart);
+		AppendInteger(builtIndex, from);
+		AppendInteger(builtIndex, to - from);
+		count++;
+	};
+
+	while (lineStart < size)
+	{
+		size_t lineEnd = lineStart;
+		while (lineEnd < size && data[lineEnd] != '\n')
+			lineEnd++;
+
+		if (data[lineStart] == '#')
+		{
+			AddEntry(start, lineStart);
+
+			// rest of the separator line is the name of the next puzzle
+			nameStart = lineStart + 1;
+			nameEnd = lineEnd;
+			while (nameStart < nameEnd && data[nameStart] == ' ')
+				nameStart++;
+			while (nameEnd > nameStart && (data[nameEnd - 1] == '\r' || data[nameEnd - 1] == ' '))
+				nameEnd--;
+
+			start = lineEnd < size ? lineEnd + 1 : size;
+		}
+
+		lineStart = lineEnd + 1;
+	}
+
+	AddEntry(start, size);
+
+	std::string countBytes;
+	AppendInteger(countBytes, count);
+	builtIndex.replace(24, 8, countBytes);
+
+	entries = builtIndex.data() + indexHeaderSize;
+}
+
+void Corpus::WriteIndex(const std::string& indexFilename) const
+{
+	// Written aside and renamed, so other processes open either no index or all of it. An
+	// index that cannot be written, like next to a corpus on a read-only disk, is built
+	// again next time.
+	const std::string writingFilename = indexFilename + ".tmp";
+	{
+		std::ofstream stream(writingFilename, std::ios::binary | std::ios::trunc);
+		stream.write(builtIndex.data(), builtIndex.size());
+		if (!stream.flush())
+			return;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(writingFilename, indexFilename, error);
+	if (error)
+		std::filesystem::remove(writingFilename, error);
+}
+
+std::string_view Corpus::GetText(int index, int field) const
+{
+	if (index < 0 || index >= count)
+		return std::string_view();
+
+	const char* entry = entries + index * indexEntrySize + field * 16;
+	uint64_t offset = ReadInteger(entry);
+	uint64_t size = ReadInteger(entry + 8);
+
+	// offsets of an index file are checked when they are used, not all of them at open
+	if (offset > file.GetSize() || size > file.GetSize() - offset)
+		return std::string_view();
+
+	return std::string_view(file.GetData() + offset, size);
+}
+
+std::string_view Corpus::GetName(int index) const
+{
+	return GetText(index, 0);
+}
+
+bool Corpus::Load(int index, Board& board) const
+{
+	if (index < 0 || index >= count)
+		return false;
+
+	auto content = GetText(index, 1);
+	return board.Load(content.data(), content.size());
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+#include "NurikabeBoard.h"
+#include "NurikabeMappedFile.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Nurikabe
+{
+	// A text file holding one or more puzzles. Puzzles are separated by lines
+	// starting with '#', the rest of such line is the name of the puzzle that
+	// follows. A file without any separator is a corpus of a single puzzle.
+	//
+	// The file is memory mapped and boards are parsed straight from the mapping.
+	// Where the puzzles start is kept next to the corpus in "<corpus>.idx", so
+	// opening a large corpus again does not read all of it. All integers are
+	// little endian.
+	//
+	//   header   "NKCX", u8 version, 3 reserved bytes, u64 corpus size,
+	//            u64 last write time of the corpus, u64 puzzle count
+	//   entries  u64 name offset, u64 name size, u64 content offset, u64 content size
+	//
+	// An index that does not match the size and write time of the corpus is
+	// built again. Single puzzle files never get one.
+	class Corpus
+	{
+		MappedFile file;
+
+		// entries of the index, either mapped from the index file or built in memory
+		MappedFile indexFile;
+		std::string builtIndex;
+		const char* entries;
+		int count;
+
+	public:
+		Corpus();
+
+		bool Open(const char* filename);
+		void Close();
+
+		int GetCount() const { return count; }
+
+		// name given by the separator line, empty when there is none
+		std::string_view GetName(int index) const;
+
+		bool Load(int index, Board& board) const;
+
+	private:
+		bool OpenIndex(const std::string& indexFilename, int64_t writeTime);
+		void BuildIndex(int64_t writeTime);
+		void WriteIndex(const std::string& indexFilename) const;
+
+		std::string_view GetText(int index, int field) const;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,481 @@
+#include "NurikabeDeductionLog.h"
+#include "NurikabeSolver.h"
+#include <climits>
+#include <unordered_map>
+#include <vector>
+
+using namespace Nurikabe;
+
+// the rule has to fit next to the state into the low 7 bits of a decided square
+static_assert(Solver::PhaseCount + 1 <= 64);
+
+static void AppendVarint(std::string& out, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		out += (char)(value | 0x80);
+		value >>= 7;
+	}
+	out += (char)value;
+}
+
+DeductionLogWriter::DeductionLogWriter(Observer* next)
+	: next(next)
+	, width(0)
+	, node(-1)
+{
+}
+
+bool DeductionLogWriter::Open(const char* filename)
+{
+	stream.open(filename, std::ios::binary | std::ios::trunc);
+	if (!stream)
+		return false;
+
+	stream.write(DeductionLog::Magic, sizeof(DeductionLog::Magic));
+	stream.put((char)DeductionLog::Version);
+	return (bool)stream;
+}
+
+void DeductionLogWriter::Begin(const Board& puzzle)
+{
+	width = puzzle.GetWidth();
+	node = -1;
+
+	buffer += (char)DeductionLog::Puzzle;
+	AppendVarint(buffer, puzzle.GetWidth());
+	AppendVarint(buffer, puzzle.GetHeight());
+}
+
+void DeductionLogWriter::End()
+{
+	buffer += (char)DeductionLog::PuzzleEnd;
+	stream.write(buffer.data(), buffer.size());
+	buffer.clear();
+}
+
+bool DeductionLogWriter::Close()
+{
+	stream.write(buffer.data(), buffer.size());
+	buffer.clear();
+	stream.close();
+	return !stream.fail();
+}
+
+void DeductionLogWriter::OnPhaseStart(const Solver& solver, int phase)
+{
+	if (next)
+		next->OnPhaseStart(solver, phase);
+}
+
+void DeductionLogWriter::OnPhaseEnd(const Solver& solver, int phase, bool hasChanged, bool isValid)
+{
+	if (next)
+		next->OnPhaseEnd(solver, phase, hasChanged, isValid);
+}
+
+void DeductionLogWriter::OnCellDecided(const Solver& solver, const Point& pt, SquareState state, int phase)
+{
+	// squares come in runs of the same node, which is only written when it changes
+	if (solver.GetId() != node)
+	{
+		node = solver.GetId();
+		buffer += (char)DeductionLog::Node;
+		AppendVarint(buffer, node);
+	}
+
+	buffer += (char)(DeductionLog::Decided | ((phase + 1) << 1) | (state == SquareState::Black ? 1 : 0));
+	AppendVarint(buffer, pt.y * width + pt.x);
+
+	// a long solve is written in pieces
+	if (buffer.size() > (1 << 20))
+	{
+		stream.write(buffer.data(), buffer.size());
+		buffer.clear();
+	}
+
+	if (next)
+		next->OnCellDecided(solver, pt, state, phase);
+}
+
+void DeductionLogWriter::OnBranch(const Solver& solver, const Solver& branch, const Point& pt, SquareState state)
+{
+	buffer += (char)DeductionLog::Guess;
+	AppendVarint(buffer, solver.GetId());
+	AppendVarint(buffer, branch.GetId());
+	AppendVarint(buffer, pt.y * width + pt.x);
+	buffer += (char)(state == SquareState::Black ? 1 : 0);
+
+	if (next)
+		next->OnBranch(solver, branch, pt, state);
+}
+
+void DeductionLogWriter::OnBacktrack(const Solver& solver)
+{
+	buffer += (char)DeductionLog::Backtrack;
+	AppendVarint(buffer, solver.GetId());
+
+	if (next)
+		next->OnBacktrack(solver);
+}
+
+void DeductionLogWriter::OnProgress(const Solver& solver)
+{
+	if (next)
+		next->OnProgress(solver);
+}
+
+void DeductionLogWriter::OnSolved(const Solver& solver)
+{
+	buffer += (char)DeductionLog::Solved;
+	AppendVarint(buffer, solver.GetId());
+
+	if (next)
+		next->OnSolved(solver);
+}
+
+bool DeductionLogReader::Open(const char* filename)
+{
+	if (!file.Open(filename, true))
+		return false;
+
+	const char* data = file.GetData();
+	if (file.GetSize() < sizeof(DeductionLog::Magic) + 1 || std::char_traits<char>::compare(data, DeductionLog::Magic, sizeof(DeductionLog::Magic)) != 0)
+		return false;
+
+	if ((uint8_t)data[sizeof(DeductionLog::Magic)] != DeductionLog::Version)
+		return false;
+
+	offset = sizeof(DeductionLog::Magic) + 1;
+	return true;
+}
+
+// Reads the log of one puzzle from memory, every read fails once the end is passed.
+struct LogCursor
+{
+	const uint8_t* data;
+	size_t size;
+	size_t& offset;
+
+	bool ReadByte(uint8_t& value)
+	{
+		if (offset >= size)
+			return false;
+		value = data[offset++];
+		return true;
+	}
+
+	bool ReadVarint(int& value)
+	{
+		uint64_t result = 0;
+		for (int shift = 0; shift < 35; shift += 7)
+		{
+			uint8_t byte;
+			if (!ReadByte(byte))
+				return false;
+
+			result |= (uint64_t)(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+			{
+				if (result > INT_MAX)
+					return false;
+				value = (int)result;
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+static std::string SquareName(int square, int width)
+{
+	// appended one by one, GCC 12 warns about a false overlap in "(" + std::to_string(...)
+	std::string name = "(";
+	name += std::to_string(square % width);
+	name += ", ";
+	name += std::to_string(square / width);
+	name += ")";
+	return name;
+}
+
+// Checks every rule of Nurikabe with one pass over the squares and one flood
+// fill of every island and of the black wall.
+static bool IsValidSolution(const Board& puzzle, const std::vector<SquareState>& states, std::string& error)
+{
+	const int width = puzzle.GetWidth();
+	const int height = puzzle.GetHeight();
+	const int squareCount = width * height;
+
+	int blackCount = 0;
+	int firstBlack = -1;
+	for (int i = 0; i < squareCount; i++)
+	{
+		if (states[i] == SquareState::Unknown)
+		{
+			error = "square " + SquareName(i, width) + " is not decided";
+			return false;
+		}
+
+		if (states[i] != SquareState::Black)
+			continue;
+
+		if (firstBlack < 0)
+			firstBlack = i;
+		blackCount++;
+
+		int x = i % width;
+		if (x + 1 < width && i + width < squareCount && states[i + 1] == SquareState::Black &&
+			states[i + width] == SquareState::Black && states[i + width + 1] == SquareState::Black)
+		{
+			error = "2x2 black at " + SquareName(i, width);
+			return false;
+		}
+	}
+
+	std::vector<bool> isVisited(squareCount, false);
+	std::vector<int> pending;
+	auto Fill = [&](int start, SquareState state, int& clueCount, int& clueSize, int& fillSize)
+	{
+		clueCount = 0;
+		clueSize = 0;
+		fillSize = 0;
+
+		pending.assign(1, start);
+		isVisited[start] = true;
+		while (!pending.empty())
+		{
+			int square = pending.back();
+			pending.pop_back();
+			fillSize++;
+
+			int size = puzzle.GetRequiredSize({ square % width, square / width });
+			if (size > 0)
+			{
+				clueCount++;
+				clueSize = size;
+			}
+
+			int x = square % width;
+			const int neighbours[] = { x > 0 ? square - 1 : -1, x + 1 < width ? square + 1 : -1, square - width, square + width };
+			for (int neighbour : neighbours)
+			{
+				if (neighbour < 0 || neighbour >= squareCount || isVisited[neighbour] || states[neighbour] != state)
+					continue;
+
+				isVisited[neighbour] = true;
+				pending.push_back(neighbour);
+			}
+		}
+	};
+
+	int clueCount, clueSize, fillSize;
+	if (firstBlack >= 0)
+	{
+		Fill(firstBlack, SquareState::Black, clueCount, clueSize, fillSize);
+		if (fillSize != blackCount)
+		{
+			error = "black is not contiguous";
+			return false;
+		}
+	}
+
+	for (int i = 0; i < squareCount; i++)
+	{
+		if (isVisited[i])
+			continue;
+
+		Fill(i, SquareState::White, clueCount, clueSize, fillSize);
+		if (clueCount != 1)
+		{
+			error = "island at " + SquareName(i, width) + " has " + std::to_string(clueCount) + " clues";
+			return false;
+		}
+
+		if (fillSize != clueSize)
+		{
+			error = "island at " + SquareName(i, width) + " has " + std::to_string(fillSize) + " squares instead of " + std::to_string(clueSize);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool DeductionLogReader::Replay(const Board& puzzle, DeductionReplay& replay)
+{
+	replay = DeductionReplay();
+	LogCursor cursor = { (const uint8_t*)file.GetData(), file.GetSize(), offset };
+
+	const int width = puzzle.GetWidth();
+	const int squareCount = width * puzzle.GetHeight();
+
+	uint8_t type;
+	int logWidth, logHeight;
+	if (!cursor.ReadByte(type) || type != DeductionLog::Puzzle || !cursor.ReadVarint(logWidth) || !cursor.ReadVarint(logHeight))
+	{
+		replay.error = "log of the puzzle is missing";
+		return false;
+	}
+
+	if (logWidth != width || logHeight != puzzle.GetHeight())
+	{
+		replay.error = "log is of a " + std::to_string(logWidth) + "x" + std::to_string(logHeight) + " puzzle";
+		return false;
+	}
+
+	struct Decision
+	{
+		int node;
+		int square;
+		SquareState state;
+	};
+
+	struct Guess
+	{
+		int node;
+		// decisions logged before the guess was made, later ones of its node are not part of it
+		int decisionCount;
+		int square;
+		SquareState state;
+	};
+
+	std::vector<Decision> decisions;
+	std::unordered_map<int, Guess> guesses;
+	int solvedNode = -1;
+	int node = -1;
+
+	// reads the whole log of the puzzle first, the node that found the solution is near its end
+	while (true)
+	{
+		if (!cursor.ReadByte(type))
+		{
+			replay.error = "log ends within the puzzle";
+			return false;
+		}
+
+		if (type == DeductionLog::PuzzleEnd)
+			break;
+
+		bool isValid = true;
+		if (type & DeductionLog::Decided)
+		{
+			int square = -1;
+			isValid = cursor.ReadVarint(square) && square < squareCount && node >= 0;
+			if (isValid)
+				decisions.push_back({ node, square, (type & 1) ? SquareState::Black : SquareState::White });
+		}
+		else if (type == DeductionLog::Node)
+			isValid = cursor.ReadVarint(node);
+		else if (type == DeductionLog::Guess)
+		{
+			int parent = -1;
+			int child = -1;
+			int square = -1;
+			uint8_t isBlack = 0;
+			isValid = cursor.ReadVarint(parent) && cursor.ReadVarint(child) && cursor.ReadVarint(square) && cursor.ReadByte(isBlack) && square < squareCount;
+			if (isValid)
+				guesses[child] = { parent, (int)decisions.size(), square, isBlack ? SquareState::Black : SquareState::White };
+		}
+		else if (type == DeductionLog::Backtrack || type == DeductionLog::Solved)
+		{
+			int id = -1;
+			isValid = cursor.ReadVarint(id) && id >= 0;
+			if (isValid && type == DeductionLog::Solved)
+				solvedNode = id;
+			else if (isValid)
+				replay.backtrackCount++;
+		}
+		else
+			isValid = false;
+
+		if (!isValid)
+		{
+			replay.error = "log is damaged at byte " + std::to_string(offset);
+			return false;
+		}
+	}
+
+	replay.decidedCount = (int)decisions.size();
+	replay.guessCount = (int)guesses.size();
+
+	if (solvedNode < 0)
+	{
+		replay.error = "log holds no solution";
+		return false;
+	}
+
+	// decisions of every node on the way from the first one to the solution
+	std::vector<SquareState> states(squareCount, SquareState::Unknown);
+	std::unordered_map<int, int> decisionCounts;
+	decisionCounts[solvedNode] = INT_MAX;
+
+	auto Apply = [&](int square, SquareState state)
+	{
+		if (states[square] != SquareState::Unknown && states[square] != state)
+		{
+			replay.error = "square " + SquareName(square, width) + " is decided both white and black";
+			return false;
+		}
+
+		states[square] = state;
+		replay.replayedCount++;
+		return true;
+	};
+
+	for (int child = solvedNode; ; )
+	{
+		auto guess = guesses.find(child);
+		if (guess == guesses.end())
+			break;
+
+		// a log of a tree has no cycles, a damaged one might
+		if (decisionCounts.count(guess->second.node))
+		{
+			replay.error = "node " + std::to_string(guess->second.node) + " is guessed from twice";
+			return false;
+		}
+
+		decisionCounts[guess->second.node] = guess->second.decisionCount;
+		if (!Apply(guess->second.square, guess->second.state))
+			return false;
+
+		child = guess->second.node;
+	}
+
+	for (int i = 0; i < (int)decisions.size(); i++)
+	{
+		auto decisionCount = decisionCounts.find(decisions[i].node);
+		if (decisionCount != decisionCounts.end() && i < decisionCount->second && !Apply(decisions[i].square, decisions[i].state))
+			return false;
+	}
+
+	// clues are white from the start, the log never decides them
+	for (int i = 0; i < squareCount; i++)
+	{
+		const Point pt = { i % width, i / width };
+		if (puzzle.GetRequiredSize(pt) <= 0)
+			continue;
+
+		if (states[i] == SquareState::Black)
+		{
+			replay.error = "clue at " + SquareName(i, width) + " is decided black";
+			return false;
+		}
+		states[i] = SquareState::White;
+	}
+
+	if (!IsValidSolution(puzzle, states, replay.error))
+		return false;
+
+	replay.solution = puzzle;
+	for (int i = 0; i < squareCount; i++)
+	{
+		const Point pt = { i % width, i / width };
+		if (states[i] == SquareState::Black)
+			replay.solution.SetBlack(pt);
+		else
+			replay.solution.SetWhite(pt);
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+#include "NurikabeBoard.h"
+#include "NurikabeMappedFile.h"
+#include "NurikabeObserver.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace Nurikabe
+{
+	// Binary log of how every square of a puzzle was decided, written while
+	// solving and replayed without running any rule. Integers are varints.
+	//
+	//   header   "NKDL", u8 version
+	//   puzzles  'P', varint width, varint height, records, 'E'
+	//   records  u8 0x80 | rule << 1 | black, varint square
+	//                     square decided by the current node
+	//            'N', varint node                 following squares are decided by this node
+	//            'G', varint node, varint guess, varint square, u8 black
+	//                     node guesses the state of a square in a new node
+	//            'X', varint node                 node has no solution and was dropped
+	//            'S', varint node                 node holds a solution
+	//
+	// where square is y * width + x, rule is 1 + the phase of Solver::SolvePhase
+	// or 0 around islands completed outside of the rules, and a node is a search
+	// node of the solver, see Solver::GetId.
+	namespace DeductionLog
+	{
+		constexpr char Magic[4] = { 'N', 'K', 'D', 'L' };
+		constexpr uint8_t Version = 2;
+
+		constexpr uint8_t Decided = 0x80;
+		constexpr uint8_t Puzzle = 'P';
+		constexpr uint8_t PuzzleEnd = 'E';
+		constexpr uint8_t Node = 'N';
+		constexpr uint8_t Guess = 'G';
+		constexpr uint8_t Backtrack = 'X';
+		constexpr uint8_t Solved = 'S';
+	}
+
+	// Writes the log of every solve it observes. Events are passed on to
+	// @p next , so progress can still be printed while logging.
+	class DeductionLogWriter : public Observer
+	{
+		std::ofstream stream;
+		std::string buffer;
+		Observer* next;
+
+		int width;
+		// node of the last decided square
+		int node;
+
+	public:
+		explicit DeductionLogWriter(Observer* next = nullptr);
+
+		bool Open(const char* filename);
+
+		/// @brief Starts the log of solving @p puzzle , every solve needs its own Begin and End.
+		void Begin(const Board& puzzle);
+		void End();
+
+		/// @brief Writes what is left, the log is not complete before this is called.
+		bool Close();
+
+		void OnPhaseStart(const Solver& solver, int phase) override;
+		void OnPhaseEnd(const Solver& solver, int phase, bool hasChanged, bool isValid) override;
+		void OnCellDecided(const Solver& solver, const Point& pt, SquareState state, int phase) override;
+		void OnBranch(const Solver& solver, const Solver& branch, const Point& pt, SquareState state) override;
+		void OnBacktrack(const Solver& solver) override;
+		void OnProgress(const Solver& solver) override;
+		void OnSolved(const Solver& solver) override;
+	};
+
+	struct DeductionReplay
+	{
+		// squares decided by rules and guesses of the whole log, and those on the way to the solution
+		int decidedCount = 0;
+		int guessCount = 0;
+		int backtrackCount = 0;
+		int replayedCount = 0;
+
+		Board solution;
+		std::string error;
+	};
+
+	// Reads the logs of puzzles in the order they were solved.
+	class DeductionLogReader
+	{
+		MappedFile file;
+		size_t offset = 0;
+
+	public:
+		bool Open(const char* filename);
+
+		/// @brief Replays the log of the next puzzle onto @p puzzle . Only squares decided by the node that found the solution and by the nodes it guessed from are applied, then the result is checked to be a solution. Takes time linear in the size of the log and the board. Returns false with @p replay .error set when the log does not lead to a solution.
+		bool Replay(const Board& puzzle, DeductionReplay& replay);
+
+		bool IsAtEnd() const { return offset >= file.GetSize(); }
+	};
+}
\ No newline at end of file
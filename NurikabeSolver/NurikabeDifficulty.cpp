@@ -0,0 +1,57 @@
+#include "NurikabeDifficulty.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+using namespace Nurikabe;
+
+Difficulty Nurikabe::EstimateDifficulty(const Board& puzzle)
+{
+	const int width = puzzle.GetWidth();
+	const int height = puzzle.GetHeight();
+
+	Difficulty difficulty;
+	difficulty.squareCount = width * height;
+
+	// clues reaching every square, saturated at 2
+	std::vector<uint8_t> reachCounts(difficulty.squareCount, 0);
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			Point pt = { x, y };
+			if (!puzzle.IsWhite(pt) || puzzle.Get(pt).GetSize() <= 0)
+				continue;
+
+			difficulty.clueCount++;
+
+			// an island reaches at most its size - 1 steps away from its clue
+			const int reach = std::min((int)puzzle.Get(pt).GetSize() - 1, width + height);
+			for (int py = std::max(y - reach, 0); py <= std::min(y + reach, height - 1); py++)
+			{
+				const int rowReach = reach - std::abs(py - y);
+				for (int px = std::max(x - rowReach, 0); px <= std::min(x + rowReach, width - 1); px++)
+				{
+					uint8_t& count = reachCounts[py * width + px];
+					count = std::min(count + 1, 2);
+				}
+			}
+		}
+	}
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			if (reachCounts[y * width + x] >= 2 && puzzle.Get({ x, y }).GetState() == SquareState::Unknown)
+				difficulty.contestedCount++;
+		}
+	}
+
+	const double contested = difficulty.contestedCount;
+	difficulty.cost = (double)difficulty.squareCount * difficulty.clueCount + 4.0 * contested * contested;
+
+	return difficulty;
+}
\ No newline at end of file
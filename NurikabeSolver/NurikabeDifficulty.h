@@ -0,0 +1,26 @@
+#pragma once
+#include "NurikabeBoard.h"
+
+namespace Nurikabe
+{
+	// What a puzzle looks like before solving it, used to guess how long solving takes.
+	//
+	// Every pass of the rules visits about every square, roughly a microsecond per
+	// square, and passes are needed about once per clue plus for every square that
+	// more than one island can reach, growing with how crowded the board is:
+	//   cost = squares * (clues + 4 * contested * contested / squares)
+	// Measured on the puzzles of this directory the cost is within a factor of a few
+	// of the runtime in microseconds, which is enough to tell the puzzles that take
+	// seconds from those that take milliseconds, not to predict a runtime.
+	struct Difficulty
+	{
+		int squareCount = 0;
+		int clueCount = 0;
+		// unknown squares within reach of two or more clues
+		int contestedCount = 0;
+		double cost = 0.0;
+	};
+
+	/// @brief Estimates how hard @p puzzle is without solving it, in time linear in the size of the board and the squares around each clue.
+	Difficulty EstimateDifficulty(const Board& puzzle);
+}
\ No newline at end of file
@@ -0,0 +1,731 @@
+#include "NurikabeGenerator.h"
+#include "NurikabeSolutionCount.h"
+#include "NurikabeSolver.h"
+#include <algorithm>
+#include <climits>
+#include <numeric>
+
+using namespace Nurikabe;
+
+// every island needs an origin below NoOrigin
+static const int maxIslandCount = NoOrigin;
+
+Generator::Generator(const Settings& settings, uint64_t seed)
+	: settings(settings)
+	, random(seed)
+	, islandCount(0)
+	, blackCount(0)
+	, searchStamp(0)
+{
+}
+
+bool Generator::IsBlackConnectedWithout(int index) const
+{
+	const int width = settings.width;
+	const int height = settings.height;
+	const int x = index % width;
+	const int y = index / width;
+
+	// the wall cannot disappear completely
+	if (blackCount <= 1)
+		return false;
+
+	int starts[4];
+	int blackNeighbourCount = 0;
+	auto CheckNeighbour = [this, &starts, &blackNeighbourCount](int neighbour)
+	{
+		if (islands[neighbour] >= 0)
+			return;
+		starts[blackNeighbourCount++] = neighbour;
+	};
+	if (x > 0) CheckNeighbour(index - 1);
+	if (x < width - 1) CheckNeighbour(index + 1);
+	if (y > 0) CheckNeighbour(index - width);
+	if (y < height - 1) CheckNeighbour(index + width);
+
+	// the end of a wall can always go
+	if (blackNeighbourCount <= 1)
+		return true;
+
+	// So can a square whose black neighbours are connected through the 8 squares around it,
+	// which decides most squares without searching.
+	auto IsBlackAt = [this, width, height](int px, int py)
+	{
+		return px >= 0 && px < width && py >= 0 && py < height && islands[py * width + px] < 0;
+	};
+	const int ringX[] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+	const int ringY[] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+	int groupCount = 0;
+	for (int i = 0; i < 8; i += 2)
+	{
+		// a neighbour starts a group unless it is joined to the one before it through their corner
+		if (!IsBlackAt(x + ringX[i], y + ringY[i]))
+			continue;
+		int previous = (i + 6) % 8;
+		if (!IsBlackAt(x + ringX[(i + 7) % 8], y + ringY[(i + 7) % 8]) || !IsBlackAt(x + ringX[previous], y + ringY[previous]))
+			groupCount++;
+	}
+	if (groupCount <= 1)
+		return true;
+
+	// Otherwise a search starts at every black neighbour, all of them a square at a time. The
+	// wall is connected, so it stays connected once the searches have met, and falls apart when
+	// some of them run out of squares first. Either happens long before the whole wall is
+	// covered, unless the square cuts the wall in halves.
+	if (searchMarks.size() != islands.size() || searchStamp > INT_MAX - 8)
+	{
+		searchMarks.assign(islands.size(), 0);
+		searchStamp = 0;
+	}
+	searchStamp += 8;
+
+	// squares marked with the stamp plus the search that reached them, the removed one with 5
+	const int removedMark = searchStamp + 5;
+	searchMarks[index] = removedMark;
+
+	int groups[4];
+	size_t heads[4];
+	for (int i = 0; i < blackNeighbourCount; i++)
+	{
+		groups[i] = i;
+		heads[i] = 0;
+		searchQueues[i].assign(1, starts[i]);
+		searchMarks[starts[i]] = searchStamp + 1 + i;
+	}
+
+	auto FindGroup = [&groups](int search)
+	{
+		while (groups[search] != search)
+			search = groups[search];
+		return search;
+	};
+
+	while (true)
+	{
+		for (int search = 0; search < blackNeighbourCount; search++)
+		{
+			auto& queue = searchQueues[search];
+			if (heads[search] >= queue.size())
+				continue;
+
+			int current = queue[heads[search]++];
+			int cx = current % width;
+			int cy = current / width;
+
+			auto Visit = [&](int neighbour)
+			{
+				if (islands[neighbour] >= 0)
+					return;
+
+				int mark = searchMarks[neighbour];
+				if (mark == removedMark)
+					return;
+
+				if (mark <= searchStamp)
+				{
+					searchMarks[neighbour] = searchStamp + 1 + search;
+					queue.push_back(neighbour);
+					return;
+				}
+
+				int group = FindGroup(mark - searchStamp - 1);
+				int ownGroup = FindGroup(search);
+				if (group != ownGroup)
+					groups[group] = ownGroup;
+			};
+			if (cx > 0) Visit(current - 1);
+			if (cx < width - 1) Visit(current + 1);
+			if (cy > 0) Visit(current - width);
+			if (cy < height - 1) Visit(current + width);
+		}
+
+		int groupsLeft = 0;
+		for (int search = 0; search < blackNeighbourCount; search++)
+			groupsLeft += FindGroup(search) == search;
+		if (groupsLeft <= 1)
+			return true;
+
+		// a group without squares left to visit is cut off from the others
+		for (int group = 0; group < blackNeighbourCount; group++)
+		{
+			if (FindGroup(group) != group)
+				continue;
+
+			bool isExhausted = true;
+			for (int search = 0; search < blackNeighbourCount && isExhausted; search++)
+				isExhausted = FindGroup(search) != group || heads[search] >= searchQueues[search].size();
+			if (isExhausted)
+				return false;
+		}
+	}
+}
+
+bool Generator::IsInBlackPool(int index) const
+{
+	const int width = settings.width;
+	const int height = settings.height;
+	const int x = index % width;
+	const int y = index / width;
+
+	if (islands[index] >= 0)
+		return false;
+
+	auto IsBlack = [this, width](int px, int py) { return islands[py * width + px] < 0; };
+	for (int py = std::max(y - 1, 0); py <= std::min(y, height - 2); py++)
+	{
+		for (int px = std::max(x - 1, 0); px <= std::min(x, width - 2); px++)
+		{
+			if (IsBlack(px, py) && IsBlack(px + 1, py) && IsBlack(px, py + 1) && IsBlack(px + 1, py + 1))
+				return true;
+		}
+	}
+	return false;
+}
+
+bool Generator::CanBeWhite(int index, bool canMerge, int& joinedIsland) const
+{
+	const int width = settings.width;
+	const int height = settings.height;
+	const int x = index % width;
+	const int y = index / width;
+
+	if (islands[index] >= 0)
+		return false;
+
+	// a square touching two islands merges them into one
+	int touched[4];
+	int touchedCount = 0;
+	auto CheckNeighbour = [this, &touched, &touchedCount](int neighbour)
+	{
+		int island = islands[neighbour];
+		if (island >= 0 && std::find(touched, touched + touchedCount, island) == touched + touchedCount)
+			touched[touchedCount++] = island;
+	};
+	if (x > 0) CheckNeighbour(index - 1);
+	if (x < width - 1) CheckNeighbour(index + 1);
+	if (y > 0) CheckNeighbour(index - width);
+	if (y < height - 1) CheckNeighbour(index + width);
+
+	if (touchedCount > 1 && !canMerge)
+		return false;
+
+	int size = 1;
+	for (int i = 0; i < touchedCount; i++)
+		size += islandSizes[touched[i]];
+	if (size > settings.maxIslandSize)
+		return false;
+
+	joinedIsland = touchedCount > 0 ? touched[0] : -1;
+	if (joinedIsland < 0 && (int)islandSizes.size() >= maxIslandCount)
+		return false;
+
+	return IsBlackConnectedWithout(index);
+}
+
+void Generator::MakeWhite(int index, int island)
+{
+	if (island < 0)
+	{
+		island = (int)islandSizes.size();
+		islandSizes.push_back(0);
+		islandCount++;
+
+		// sizes are only drawn when asked for, so other puzzles of a seed stay the same
+		if (settings.meanIslandSize > 0.0)
+		{
+			int size = 1 + std::geometric_distribution<int>(1.0 / std::max(settings.meanIslandSize, 1.0))(random);
+			islandTargetSizes.push_back(std::min(size, settings.maxIslandSize));
+		}
+	}
+
+	const int width = settings.width;
+	const int height = settings.height;
+	const int x = index % width;
+	const int y = index / width;
+
+	// islands the square connects to become part of the one it joins
+	auto Merge = [this, island](int neighbour)
+	{
+		int other = islands[neighbour];
+		if (other < 0 || other == island)
+			return;
+
+		std::replace(islands.begin(), islands.end(), other, island);
+		islandSizes[island] += islandSizes[other];
+		islandSizes[other] = 0;
+		islandCount--;
+	};
+	if (x > 0) Merge(index - 1);
+	if (x < width - 1) Merge(index + 1);
+	if (y > 0) Merge(index - width);
+	if (y < height - 1) Merge(index + width);
+
+	islands[index] = island;
+	islandSizes[island]++;
+	blackCount--;
+}
+
+void Generator::MakeBlack(int index)
+{
+	islandSizes[islands[index]]--;
+	islands[index] = -1;
+	blackCount++;
+}
+
+// Makes @p index white although that cuts the wall apart. The largest part stays
+// black and the others become white too, joining the island of @p index . Returns
+// the number of new white squares, 0 when the island would become too large.
+int Generator::MakeWhiteCuttingWall(int index)
+{
+	const int width = settings.width;
+	const int height = settings.height;
+	const int squareCount = width * height;
+
+	// part of the wall of every black square, found from the black neighbours of index
+	std::vector<int> parts(squareCount, -1);
+	std::vector<std::vector<int>> partSquares;
+	parts[index] = -2;
+
+	auto ForEachNeighbour = [width, height](int square, auto&& callback)
+	{
+		int sx = square % width;
+		int sy = square / width;
+		if (sx > 0) callback(square - 1);
+		if (sx < width - 1) callback(square + 1);
+		if (sy > 0) callback(square - width);
+		if (sy < height - 1) callback(square + width);
+	};
+
+	ForEachNeighbour(index, [&](int start)
+	{
+		if (islands[start] >= 0 || parts[start] != -1)
+			return;
+
+		int part = (int)partSquares.size();
+		partSquares.emplace_back(1, start);
+		parts[start] = part;
+
+		auto& queue = partSquares.back();
+		for (size_t i = 0; i < queue.size(); i++)
+		{
+			ForEachNeighbour(queue[i], [&](int neighbour)
+			{
+				if (islands[neighbour] >= 0 || parts[neighbour] != -1)
+					return;
+				parts[neighbour] = part;
+				queue.push_back(neighbour);
+			});
+		}
+	});
+
+	int largest = 0;
+	for (int part = 1; part < (int)partSquares.size(); part++)
+	{
+		if (partSquares[part].size() > partSquares[largest].size())
+			largest = part;
+	}
+
+	// what becomes white, and every island it touches
+	std::vector<int> whites = { index };
+	for (int part = 0; part < (int)partSquares.size(); part++)
+	{
+		if (part != largest)
+			whites.insert(whites.end(), partSquares[part].begin(), partSquares[part].end());
+	}
+
+	std::vector<int> touched;
+	for (int white : whites)
+	{
+		ForEachNeighbour(white, [&](int neighbour)
+		{
+			int island = islands[neighbour];
+			if (island >= 0 && std::find(touched.begin(), touched.end(), island) == touched.end())
+				touched.push_back(island);
+		});
+	}
+
+	int size = (int)whites.size();
+	for (int island : touched)
+		size += islandSizes[island];
+	if (size > settings.maxIslandSize || (touched.empty() && (int)islandSizes.size() >= maxIslandCount))
+		return 0;
+
+	// every square merges the islands it touches into the one of index
+	MakeWhite(index, touched.empty() ? -1 : touched[0]);
+	for (size_t i = 1; i < whites.size(); i++)
+		MakeWhite(whites[i], islands[index]);
+
+	return (int)whites.size();
+}
+
+bool Generator::CanBeBlack(int index, const std::vector<int>& clues) const
+{
+	const int width = settings.width;
+	const int height = settings.height;
+	const int x = index % width;
+	const int y = index / width;
+
+	const int island = islands[index];
+	if (island < 0 || clues[island] == index)
+		return false;
+
+	// joining the wall keeps it connected, but a square surrounded by white would be cut off
+	bool isTouchingWall = false;
+	auto CheckNeighbour = [this, &isTouchingWall](int neighbour)
+	{
+		if (islands[neighbour] < 0)
+			isTouchingWall = true;
+	};
+	if (x > 0) CheckNeighbour(index - 1);
+	if (x < width - 1) CheckNeighbour(index + 1);
+	if (y > 0) CheckNeighbour(index - width);
+	if (y < height - 1) CheckNeighbour(index + width);
+
+	if (!isTouchingWall)
+		return false;
+
+	auto IsBlack = [this, width, index](int px, int py) { return py * width + px == index || islands[py * width + px] < 0; };
+	for (int py = std::max(y - 1, 0); py <= std::min(y, height - 2); py++)
+	{
+		for (int px = std::max(x - 1, 0); px <= std::min(x, width - 2); px++)
+		{
+			if (IsBlack(px, py) && IsBlack(px + 1, py) && IsBlack(px, py + 1) && IsBlack(px + 1, py + 1))
+				return false;
+		}
+	}
+
+	// rest of the island has to stay connected to its clue
+	std::vector<bool> isReached(width * height, false);
+	std::vector<int> queue = { clues[island] };
+	isReached[clues[island]] = true;
+	isReached[index] = true;
+
+	for (size_t i = 0; i < queue.size(); i++)
+	{
+		int current = queue[i];
+		int cx = current % width;
+		int cy = current / width;
+
+		auto Visit = [this, island, &isReached, &queue](int neighbour)
+		{
+			if (isReached[neighbour] || islands[neighbour] != island)
+				return;
+			isReached[neighbour] = true;
+			queue.push_back(neighbour);
+		};
+		if (cx > 0) Visit(current - 1);
+		if (cx < width - 1) Visit(current + 1);
+		if (cy > 0) Visit(current - width);
+		if (cy < height - 1) Visit(current + width);
+	}
+
+	return (int)queue.size() == islandSizes[island] - 1;
+}
+
+bool Generator::GenerateSolution()
+{
+	const int width = settings.width;
+	const int height = settings.height;
+	const int squareCount = width * height;
+
+	islands.assign(squareCount, -1);
+	islandSizes.clear();
+	islandTargetSizes.clear();
+	islandCount = 0;
+	blackCount = squareCount;
+
+	const int whiteTarget = (int)(settings.density * squareCount);
+	const int islandCountTarget = settings.clueDensity > 0.0 ? std::max((int)(settings.clueDensity * squareCount), 1) : INT_MAX;
+	int whiteCount = 0;
+
+	// whether a square may start a new island or grow the one it joins, given the clue density and island sizes asked for
+	const bool hasShape = settings.clueDensity > 0.0 || settings.meanIslandSize > 0.0;
+	auto IsInShape = [this, islandCountTarget](int island)
+	{
+		if (island < 0)
+			return islandCount < islandCountTarget;
+		return settings.meanIslandSize <= 0.0 || islandSizes[island] < islandTargetSizes[island];
+	};
+
+	std::vector<int> order(squareCount);
+	std::iota(order.begin(), order.end(), 0);
+
+	// Squares are added in random order, each either growing the island it touches or
+	// starting a new one. Adding never creates a 2x2 pool of black, so pools are broken
+	// up first, while the board is still mostly black and that is easy. Squares that
+	// would merge islands are only used for pools nothing else can break, and so are
+	// squares that do not fit the clue density and island sizes. A pool can still be
+	// impossible to break without cutting the wall, then the end of the wall it would
+	// cut off goes too, and only when that does not work either the solution is dropped.
+	bool isShaped = hasShape;
+	bool canMerge = false;
+	while (true)
+	{
+		bool hasPool = false;
+		bool hasChanged = false;
+		std::shuffle(order.begin(), order.end(), random);
+
+		for (int index : order)
+		{
+			if (!IsInBlackPool(index))
+				continue;
+
+			hasPool = true;
+
+			int island;
+			if (!CanBeWhite(index, canMerge, island))
+				continue;
+
+			if (isShaped && !IsInShape(island))
+				continue;
+
+			MakeWhite(index, island);
+			whiteCount++;
+			hasChanged = true;
+		}
+
+		if (!hasPool)
+			break;
+
+		if (!hasChanged)
+		{
+			if (isShaped)
+			{
+				isShaped = false;
+				continue;
+			}
+
+			if (!canMerge)
+			{
+				canMerge = true;
+				continue;
+			}
+
+			// Pools left over are held in place by squares that would cut off the end of the wall.
+			// These ends are often short, between small islands, so they can become white together
+			// with the pool. Large boards almost always have such a pool somewhere.
+			for (int index : order)
+			{
+				if (!IsInBlackPool(index))
+					continue;
+
+				int addedCount = MakeWhiteCuttingWall(index);
+				if (addedCount > 0)
+				{
+					whiteCount += addedCount;
+					hasChanged = true;
+					break;
+				}
+			}
+
+			if (!hasChanged)
+				return false;
+		}
+
+		isShaped = hasShape;
+		canMerge = false;
+	}
+
+	// then islands grow until the share of white is reached, or until no island may grow anymore
+	bool hasChanged = true;
+	while (whiteCount < whiteTarget && hasChanged)
+	{
+		hasChanged = false;
+		std::shuffle(order.begin(), order.end(), random);
+
+		for (int index : order)
+		{
+			if (whiteCount >= whiteTarget)
+				break;
+
+			int island;
+			if (!CanBeWhite(index, false, island))
+				continue;
+
+			if (!IsInShape(island))
+				continue;
+
+			MakeWhite(index, island);
+			whiteCount++;
+			hasChanged = true;
+		}
+	}
+
+	return whiteCount > 0;
+}
+
+Board Generator::GetSolution() const
+{
+	Board solution(settings.width, settings.height);
+	for (int i = 0; i < settings.width * settings.height; i++)
+	{
+		Point pt = { i % settings.width, i / settings.width };
+		if (islands[i] < 0)
+			solution.SetBlack(pt);
+		else
+			solution.SetWhite(pt);
+	}
+	return solution;
+}
+
+void Generator::PlaceClues(std::vector<int>& clues, Board& puzzle)
+{
+	const int width = settings.width;
+	const int squareCount = width * settings.height;
+
+	auto ToPoint = [width](int index) { return Point{ index % width, index / width }; };
+
+	// one clue at a random square of every island
+	clues.assign(islandSizes.size(), -1);
+	std::vector<int> seen(islandSizes.size(), 0);
+	for (int i = 0; i < squareCount; i++)
+	{
+		int island = islands[i];
+		if (island < 0)
+			continue;
+
+		// reservoir sampling, every square of the island is equally likely
+		seen[island]++;
+		if (std::uniform_int_distribution<int>(1, seen[island])(random) == 1)
+			clues[island] = i;
+	}
+
+	puzzle = Board(width, settings.height);
+	for (size_t island = 0; island < clues.size(); island++)
+	{
+		// merged into another one
+		if (clues[island] < 0)
+			continue;
+
+		puzzle.SetWhite(ToPoint(clues[island]));
+		puzzle.SetSize(ToPoint(clues[island]), islandSizes[island]);
+	}
+}
+
+bool Generator::Generate(Board& puzzle, Board& solution)
+{
+	const int width = settings.width;
+	const int height = settings.height;
+	const int squareCount = width * height;
+
+	auto ToPoint = [width](int index) { return Point{ index % width, index / width }; };
+
+	for (int attempt = 0; attempt < settings.maxAttempts; attempt++)
+	{
+		if (!GenerateSolution())
+			continue;
+
+		std::vector<int> clues;
+		Board candidate;
+		PlaceClues(clues, candidate);
+
+		if (!settings.isUnique)
+		{
+			puzzle = candidate;
+			solution = GetSolution();
+			return true;
+		}
+
+		Board start = candidate;
+		while (true)
+		{
+			int iteration = 0;
+			Solver solver(start, &iteration);
+			if (!solver.SolveByDeduction())
+				break;
+
+			const Board& state = solver.GetBoard();
+
+			// some rules rely on the puzzle having one solution, so deduction can disagree
+			// with a solution that is not the only one. Islands of 1 cannot fix that,
+			// they are only added at squares that are still unknown.
+			bool isMatching = true;
+			for (int i = 0; i < squareCount && isMatching; i++)
+			{
+				auto pt = ToPoint(i);
+				if ((state.IsBlack(pt) && islands[i] >= 0) || (state.IsWhite(pt) && islands[i] < 0))
+					isMatching = false;
+			}
+			if (!isMatching)
+				break;
+
+			if (solver.Evaluate().IsSolved())
+			{
+				// solving continued from earlier states, so confirm it works from the clues alone
+				int checkIteration = 0;
+				Solver check(candidate, &checkIteration);
+				if (!check.SolveByDeduction() || !check.Evaluate().IsSolved())
+					break;
+
+				// deduction may have picked one of several solutions
+				if (CountSolutions(candidate) != 1)
+					break;
+
+				puzzle = candidate;
+				solution = GetSolution();
+				return true;
+			}
+
+			// undecided black squares that can become an island of 1 without touching others
+			std::vector<int> options;
+			for (int i = 0; i < squareCount; i++)
+			{
+				if (islands[i] >= 0 || state.Get(ToPoint(i)).GetState() != SquareState::Unknown)
+					continue;
+
+				int island;
+				if (CanBeWhite(i, false, island) && island < 0)
+					options.push_back(i);
+			}
+
+			if (options.empty())
+			{
+				// otherwise an undecided square at the edge of an island becomes black
+				for (int i = 0; i < squareCount; i++)
+				{
+					if (state.Get(ToPoint(i)).GetState() == SquareState::Unknown && CanBeBlack(i, clues))
+						options.push_back(i);
+				}
+
+				if (options.empty())
+					break;
+
+				// the clue of the island changes, so nothing deduced so far can be trusted
+				int removed = options[std::uniform_int_distribution<size_t>(0, options.size() - 1)(random)];
+				int island = islands[removed];
+				MakeBlack(removed);
+				candidate.SetSize(ToPoint(clues[island]), islandSizes[island]);
+				start = candidate;
+				continue;
+			}
+
+			int added = options[std::uniform_int_distribution<size_t>(0, options.size() - 1)(random)];
+			MakeWhite(added, -1);
+			clues.push_back(added);
+
+			Point pt = ToPoint(added);
+			candidate.SetWhite(pt);
+			candidate.SetSize(pt, 1);
+
+			// what deduction found so far stays, plus the new clue
+			start = Board(width, height);
+			for (int i = 0; i < squareCount; i++)
+			{
+				auto square = ToPoint(i);
+				if (state.IsBlack(square))
+					start.SetBlack(square);
+				else if (state.IsWhite(square))
+					start.SetWhite(square);
+
+				int size = candidate.GetRequiredSize(square);
+				if (size != 0)
+				{
+					start.SetWhite(square);
+					start.SetSize(square, size);
+				}
+			}
+		}
+	}
+
+	return false;
+}
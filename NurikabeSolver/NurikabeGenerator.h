@@ -0,0 +1,85 @@
+#pragma once
+#include "NurikabeBoard.h"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace Nurikabe
+{
+	// Creates random puzzles that have exactly one solution, or with isUnique
+	// off, puzzles that have at least the solution they were made from.
+	//
+	// A random solution is drawn first: a connected black wall without 2x2
+	// pools and islands that do not touch each other. Every island gets one
+	// clue. The puzzle is then solved by deduction alone, and while deduction
+	// gets stuck, a black square it could not decide becomes a new island of 1.
+	// That only adds a clue, so solving continues from where it got stuck instead
+	// of starting over. When there is no room for such an island, an undecided
+	// square is taken off an island instead, which changes a clue and starts
+	// solving over. Some rules of the solver pick one of several solutions, so a
+	// puzzle that deduction solves is solved once more from its clues, and
+	// CountSolutions has to find it has a single solution before it is returned.
+	//
+	// Puzzles that do not have to be unique skip solving, so they can be made in
+	// any size, for measuring how the solver scales with the size of the board.
+	class Generator
+	{
+	public:
+		struct Settings
+		{
+			int width = 10;
+			int height = 10;
+			// share of white squares in the solution
+			double density = 0.45;
+			// largest island
+			int maxIslandSize = 35;
+			// islands per square of the solution, which is the share of clues in the puzzle. Once there
+			// are that many, white squares only grow islands. 0 leaves it to density and the island sizes
+			double clueDensity = 0.0;
+			// islands grow to a size drawn from a geometric distribution with this mean, capped at
+			// maxIslandSize, so most are small and a few are large. 0 lets every island grow freely
+			double meanIslandSize = 0.0;
+			// without it the puzzle is not solved while generating, clue density and island sizes
+			// are kept exactly then, but the puzzle can have other solutions too
+			bool isUnique = true;
+			// solutions tried before Generate gives up
+			int maxAttempts = 1000;
+		};
+
+	private:
+		Settings settings;
+		std::mt19937_64 random;
+
+		// island of every square of the solution being built, -1 for black
+		std::vector<int> islands;
+		std::vector<int> islandSizes;
+		// size every island stops growing at, only with meanIslandSize
+		std::vector<int> islandTargetSizes;
+		int islandCount;
+		int blackCount;
+
+		// marks of the searches of IsBlackConnectedWithout, kept so a search costs only the squares it visits
+		mutable std::vector<int> searchMarks;
+		mutable int searchStamp;
+		mutable std::vector<int> searchQueues[4];
+
+	public:
+		Generator(const Settings& settings, uint64_t seed);
+
+		/// @brief Creates a puzzle and its only solution, false when no attempt succeeded.
+		bool Generate(Board& puzzle, Board& solution);
+
+	private:
+		bool GenerateSolution();
+		void PlaceClues(std::vector<int>& clues, Board& puzzle);
+		bool CanBeWhite(int index, bool canMerge, int& joinedIsland) const;
+		void MakeWhite(int index, int island);
+		bool CanBeBlack(int index, const std::vector<int>& clues) const;
+		void MakeBlack(int index);
+		bool IsInBlackPool(int index) const;
+		bool IsBlackConnectedWithout(int index) const;
+		int MakeWhiteCuttingWall(int index);
+
+		Board GetSolution() const;
+	};
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace Nurikabe
+{
+	// Just enough of JSON for flat objects of strings and numbers.
+	struct JsonReader
+	{
+		std::string_view text;
+		size_t pos = 0;
+
+		void SkipSpace()
+		{
+			while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n'))
+				pos++;
+		}
+
+		bool Consume(char c)
+		{
+			SkipSpace();
+			if (pos >= text.size() || text[pos] != c)
+				return false;
+			pos++;
+			return true;
+		}
+
+		bool ReadString(std::string& out)
+		{
+			out.clear();
+			if (!Consume('"'))
+				return false;
+
+			while (pos < text.size())
+			{
+				char c = text[pos++];
+				if (c == '"')
+					return true;
+
+				if (c != '\\')
+				{
+					out.push_back(c);
+					continue;
+				}
+
+				if (pos >= text.size())
+					return false;
+
+				c = text[pos++];
+				switch (c)
+				{
+				case 'n': out.push_back('\n'); break;
+				case 'r': out.push_back('\r'); break;
+				case 't': out.push_back('\t'); break;
+				case 'b': out.push_back('\b'); break;
+				case 'f': out.push_back('\f'); break;
+				case 'u':
+				{
+					if (pos + 4 > text.size())
+						return false;
+
+					unsigned int code = 0;
+					for (int i = 0; i < 4; i++)
+					{
+						char h = text[pos++];
+						code <<= 4;
+						if (h >= '0' && h <= '9') code |= h - '0';
+						else if (h >= 'a' && h <= 'f') code |= h - 'a' + 10;
+						else if (h >= 'A' && h <= 'F') code |= h - 'A' + 10;
+						else return false;
+					}
+
+					// puzzles are plain ASCII, anything else is an unknown square anyway
+					out.push_back(code < 0x80 ? (char)code : '?');
+					break;
+				}
+				default: out.push_back(c); break;
+				}
+			}
+			return false;
+		}
+
+		// skips any value and returns its raw text
+		bool ReadRaw(std::string_view& out)
+		{
+			SkipSpace();
+			size_t start = pos;
+
+			if (pos < text.size() && text[pos] == '"')
+			{
+				std::string ignored;
+				if (!ReadString(ignored))
+					return false;
+			}
+			else
+			{
+				int nesting = 0;
+				while (pos < text.size())
+				{
+					char c = text[pos];
+					if (c == '"')
+					{
+						std::string ignored;
+						if (!ReadString(ignored))
+							return false;
+						continue;
+					}
+					if (c == '{' || c == '[')
+						nesting++;
+					else if (c == '}' || c == ']')
+					{
+						if (nesting == 0)
+							break;
+						nesting--;
+					}
+					else if (c == ',' && nesting == 0)
+						break;
+					pos++;
+				}
+			}
+
+			out = text.substr(start, pos - start);
+			while (!out.empty() && (out.back() == ' ' || out.back() == '\t' || out.back() == '\r'))
+				out.remove_suffix(1);
+
+			return !out.empty();
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "NurikabeMappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace Nurikabe;
+
+MappedFile::MappedFile()
+	: data(nullptr)
+	, size(0)
+#ifdef _WIN32
+	, fileHandle(INVALID_HANDLE_VALUE)
+	, mappingHandle(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const char* filename, bool isSequential)
+{
+	Close();
+
+#ifdef _WIN32
+	fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, isSequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		Close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+
+	// empty files cannot be mapped
+	if (size > 0)
+	{
+		mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle == nullptr)
+		{
+			Close();
+			return false;
+		}
+
+		data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (data == nullptr)
+		{
+			Close();
+			return false;
+		}
+	}
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	size = (size_t)fileStat.st_size;
+
+	// empty files cannot be mapped
+	if (size > 0)
+	{
+		void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (mapping == MAP_FAILED)
+		{
+			close(fd);
+			size = 0;
+			return false;
+		}
+
+		if (isSequential)
+			madvise(mapping, size, MADV_SEQUENTIAL);
+		data = (const char*)mapping;
+	}
+
+	// mapping stays valid after the file is closed
+	close(fd);
+#endif
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+
+	mappingHandle = nullptr;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (data)
+		munmap((void*)data, size);
+#endif
+
+	data = nullptr;
+	size = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+
+namespace Nurikabe
+{
+	// Read-only memory mapping of a whole file, shared with every other
+	// process that maps the same file.
+	class MappedFile
+	{
+		const char* data;
+		size_t size;
+
+#ifdef _WIN32
+		void* fileHandle;
+		void* mappingHandle;
+#endif
+
+	public:
+		MappedFile();
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+	public:
+		/// @brief Maps @p filename , an empty file gives no data and a size of 0. @p isSequential hints that the data is read front to back.
+		bool Open(const char* filename, bool isSequential = false);
+		void Close();
+
+		const char* GetData() const { return data; }
+		size_t GetSize() const { return size; }
+	};
+}
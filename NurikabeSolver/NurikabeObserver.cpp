@@ -0,0 +1,57 @@
+#include "NurikabeObserver.h"
+#include "NurikabeSolver.h"
+
+using namespace Nurikabe;
+
+ProgressPrinter::ProgressPrinter(std::ostream& stream, int frequency, bool isPrintingChanges)
+	: stream(stream)
+	, frequency(frequency)
+	, iterationNextPrint(0)
+	, isPrintingChanges(isPrintingChanges)
+{
+}
+
+void ProgressPrinter::OnPhaseStart(const Solver& solver, int phase)
+{
+	if (isPrintingChanges)
+		boardPhaseStart = solver.GetBoard();
+}
+
+void ProgressPrinter::OnPhaseEnd(const Solver& solver, int phase, bool hasChanged, bool isValid)
+{
+	if (!isPrintingChanges || !hasChanged)
+		return;
+
+	// squares that changed, unchanged ones are left unknown and drawn as black
+	Board diff(boardPhaseStart);
+	Board::Difference(diff, solver.GetBoard(), false);
+	diff.ForEachSquare([](const Point&, const Square& sq)
+	{
+		if (sq.GetState() == SquareState::Unknown)
+			((Square&)sq).SetState(SquareState::Black);
+
+		return true;
+	});
+
+	std::string text = "\nPhase: " + std::to_string(phase) + "\n";
+	const Board* boards[] = { &boardPhaseStart, &diff, &solver.GetBoard() };
+	Board::Print(boards, 3, text);
+
+	text += "Depth: " + std::to_string(solver.GetDepth()) + "\nIteration: " + std::to_string(solver.GetIteration()) + "\n";
+	stream.write(text.data(), text.size());
+}
+
+void ProgressPrinter::OnProgress(const Solver& solver)
+{
+	if (solver.GetIteration() < iterationNextPrint)
+		return;
+
+	std::string text = "\n";
+	solver.GetBoard().Print(text);
+	text += "Depth: " + std::to_string(solver.GetDepth()) + "\nIteration: " + std::to_string(solver.GetIteration()) + "\n";
+
+	// one write per update, whoever reads it does not need it flushed
+	stream.write(text.data(), text.size());
+
+	iterationNextPrint = solver.GetIteration() + frequency;
+}
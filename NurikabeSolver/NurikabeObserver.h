@@ -0,0 +1,68 @@
+#pragma once
+#include "NurikabeBoard.h"
+#include <ostream>
+
+// Observers can be compiled out completely, leaving no trace of them in the
+// solver. Otherwise every event costs a null check when no observer is set.
+#ifndef NURIKABE_OBSERVERS
+#define NURIKABE_OBSERVERS 1
+#endif
+
+#if NURIKABE_OBSERVERS
+#define NOTIFY_OBSERVER(solver, event) do { if ((solver).GetObserver()) (solver).GetObserver()->event; } while (false)
+#else
+#define NOTIFY_OBSERVER(solver, event) do { } while (false)
+#endif
+
+namespace Nurikabe
+{
+	class Solver;
+
+	// Receives events of a solver and of every solver it branches into. All
+	// events are called on the thread that is solving, before the solver moves on.
+	class Observer
+	{
+	public:
+		virtual ~Observer() = default;
+
+		/// @brief Rule @p phase is about to run, see Solver::SolvePhase.
+		virtual void OnPhaseStart(const Solver& solver, int phase) {}
+
+		/// @brief Rule @p phase finished. @p hasChanged tells whether it changed the board, @p isValid is false when it found a contradiction.
+		virtual void OnPhaseEnd(const Solver& solver, int phase, bool hasChanged, bool isValid) {}
+
+		/// @brief Square @p pt was unknown and is now @p state , decided by rule @p phase , or -1 when it surrounds an island completed before the rules ran.
+		virtual void OnCellDecided(const Solver& solver, const Point& pt, SquareState state, int phase) {}
+
+		/// @brief @p branch is a copy of @p solver that guesses @p pt is @p state .
+		virtual void OnBranch(const Solver& solver, const Solver& branch, const Point& pt, SquareState state) {}
+
+		/// @brief @p solver turned out to have no solution and is dropped.
+		virtual void OnBacktrack(const Solver& solver) {}
+
+		/// @brief Called every few iterations while the board is still solvable.
+		virtual void OnProgress(const Solver& solver) {}
+
+		/// @brief @p solver is the search node holding a solution, which is then copied into the solver that was asked to solve.
+		virtual void OnSolved(const Solver& solver) {}
+	};
+
+	// Prints the board to a stream every `frequency` iterations, optionally with
+	// every change made by a rule as before, change and after boards.
+	class ProgressPrinter : public Observer
+	{
+		std::ostream& stream;
+		int frequency;
+		int iterationNextPrint;
+
+		bool isPrintingChanges;
+		Board boardPhaseStart;
+
+	public:
+		ProgressPrinter(std::ostream& stream, int frequency = 1000, bool isPrintingChanges = false);
+
+		void OnPhaseStart(const Solver& solver, int phase) override;
+		void OnPhaseEnd(const Solver& solver, int phase, bool hasChanged, bool isValid) override;
+		void OnProgress(const Solver& solver) override;
+	};
+}
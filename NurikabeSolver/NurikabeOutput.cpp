@@ -0,0 +1,147 @@
+#include "NurikabeOutput.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+using namespace Nurikabe;
+
+Output::Output(std::ostream& stream, OutputFormat format)
+	: stream(stream)
+	, format(format)
+{
+	// large enough for results of the biggest boards we have
+	buffer.reserve(64 * 1024);
+}
+
+Output::~Output()
+{
+	Flush();
+}
+
+bool Output::ParseFormat(const char* text, OutputFormat& format)
+{
+	if (!std::strcmp(text, "human"))
+		format = OutputFormat::Human;
+	else if (!std::strcmp(text, "compact"))
+		format = OutputFormat::Compact;
+	else if (!std::strcmp(text, "json"))
+		format = OutputFormat::Json;
+	else
+		return false;
+
+	return true;
+}
+
+void Output::WriteMessage(std::string_view text)
+{
+	if (format == OutputFormat::Human)
+		buffer += text;
+}
+
+void Output::WriteError(std::string_view text)
+{
+	if (format == OutputFormat::Human)
+	{
+		buffer += text;
+		return;
+	}
+
+	std::cerr.write(text.data(), text.size());
+}
+
+void Output::WriteResult(std::string_view name, const Board& puzzle, const Result& result)
+{
+	char numbers[64];
+
+	switch (format)
+	{
+	case OutputFormat::Human:
+	{
+		if (result.isCached)
+		{
+			buffer += "Found in solution cache:\n";
+		}
+		else if (result.solution.IsLoaded())
+		{
+			buffer += "Before and After:\n";
+		}
+		else
+		{
+			buffer += "Failed to solve:\n\n";
+			puzzle.Print(buffer);
+		}
+
+		if (result.solution.IsLoaded())
+		{
+			const Board* boards[] = { &puzzle, &result.solution };
+			Board::Print(boards, 2, buffer);
+			buffer.push_back('\n');
+		}
+
+		if (!result.isCached)
+		{
+			std::snprintf(numbers, sizeof(numbers), "Runtime: %gms\nIterations: %d\n", result.runtimeMs, result.iterations);
+			buffer += numbers;
+		}
+
+		if (result.status == Result::Status::Error)
+		{
+			buffer += result.error;
+			buffer.push_back('\n');
+		}
+		break;
+	}
+
+	case OutputFormat::Compact:
+	{
+		switch (result.status)
+		{
+		case Result::Status::Solved: buffer += "solved "; break;
+		case Result::Status::Unsolved: buffer += "unsolved "; break;
+		case Result::Status::Error: buffer += "error "; break;
+		}
+
+		std::snprintf(numbers, sizeof(numbers), "%dx%d ", puzzle.GetWidth(), puzzle.GetHeight());
+		buffer += numbers;
+
+		if (result.solution.IsLoaded())
+		{
+			for (int y = 0; y < result.solution.GetHeight(); y++)
+			{
+				for (int x = 0; x < result.solution.GetWidth(); x++)
+					buffer.push_back(result.solution.IsBlack({ x, y }) ? '1' : '0');
+			}
+		}
+		else
+		{
+			buffer.push_back('-');
+		}
+
+		std::snprintf(numbers, sizeof(numbers), " %d %.3f ", result.iterations, result.runtimeMs);
+		buffer += numbers;
+		buffer += name;
+		buffer.push_back('\n');
+		break;
+	}
+
+	case OutputFormat::Json:
+	{
+		std::string id;
+		AppendJsonString(id, name);
+		result.Write(buffer, id);
+		break;
+	}
+	}
+
+	Flush();
+}
+
+void Output::Flush()
+{
+	if (buffer.empty())
+		return;
+
+	stream.write(buffer.data(), buffer.size());
+	stream.flush();
+	buffer.clear();
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "NurikabeRequest.h"
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace Nurikabe
+{
+	enum class OutputFormat
+	{
+		// boards drawn before and after solving, with runtime and iterations
+		Human,
+		// one line per puzzle: status, WxH, solution mask or '-', iterations, runtime in ms, name
+		Compact,
+		// one JSON object per puzzle, like results of --stream with the name as "id"
+		Json
+	};
+
+	// Writes results of solving to a stream. Everything belonging to one
+	// result is collected in a buffer and written to the stream at once, and
+	// the stream is flushed only once per result.
+	class Output
+	{
+		std::ostream& stream;
+		OutputFormat format;
+		std::string buffer;
+
+	public:
+		Output(std::ostream& stream, OutputFormat format);
+		~Output();
+
+		Output(const Output&) = delete;
+		Output& operator=(const Output&) = delete;
+
+	public:
+		OutputFormat GetFormat() const { return format; }
+
+		/// @brief Parses "human", "compact" or "json".
+		static bool ParseFormat(const char* text, OutputFormat& format);
+
+		/// @brief Text for people reading the output, left out of the other formats.
+		void WriteMessage(std::string_view text);
+
+		/// @brief Describes a problem outside of any result, other formats send it to stderr.
+		void WriteError(std::string_view text);
+
+		/// @brief Writes how @p puzzle named @p name was solved and flushes.
+		void WriteResult(std::string_view name, const Board& puzzle, const Result& result);
+
+		void Flush();
+	};
+}
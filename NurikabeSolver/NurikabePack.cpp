@@ -0,0 +1,234 @@
+#include "NurikabePack.h"
+#include <cstring>
+
+using namespace Nurikabe;
+
+static void WriteVarint(std::ostream& stream, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		stream.put((char)(value | 0x80));
+		value >>= 7;
+	}
+	stream.put((char)value);
+}
+
+static bool ReadVarint(std::istream& stream, uint64_t& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		int byte = stream.get();
+		if (byte == std::char_traits<char>::eof())
+			return false;
+
+		value |= (uint64_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+template<typename T>
+static void WriteInteger(std::ostream& stream, T value)
+{
+	for (int i = 0; i < sizeof(T); i++)
+		stream.put((char)(value >> (8 * i)));
+}
+
+template<typename T>
+static bool ReadInteger(std::istream& stream, T& value)
+{
+	uint8_t bytes[sizeof(T)];
+	if (!stream.read((char*)bytes, sizeof(T)))
+		return false;
+
+	value = 0;
+	for (int i = 0; i < sizeof(T); i++)
+		value |= (T)bytes[i] << (8 * i);
+	return true;
+}
+
+static void WriteHeader(std::ostream& stream, uint32_t count, uint64_t indexOffset)
+{
+	stream.write(Pack::Magic, sizeof(Pack::Magic));
+	stream.put((char)Pack::Version);
+	stream.put(0);
+	stream.put(0);
+	stream.put(0);
+	WriteInteger<uint32_t>(stream, count);
+	WriteInteger<uint64_t>(stream, indexOffset);
+}
+
+PackWriter::~PackWriter()
+{
+	if (stream.is_open())
+		Close();
+}
+
+bool PackWriter::Open(const char* filename)
+{
+	offsets.clear();
+
+	stream.open(filename, std::ios::binary | std::ios::trunc);
+	if (!stream.is_open())
+		return false;
+
+	// real values are written once the index is known
+	WriteHeader(stream, 0, 0);
+	return (bool)stream;
+}
+
+bool PackWriter::Add(const Board& puzzle, const Board* solution)
+{
+	const int width = puzzle.GetWidth();
+	const int height = puzzle.GetHeight();
+
+	if (solution && (solution->GetWidth() != width || solution->GetHeight() != height))
+		return false;
+
+	offsets.push_back((uint64_t)stream.tellp());
+
+	int clueCount = 0;
+	for (int i = 0; i < width * height; i++)
+	{
+		if (puzzle.GetRequiredSize({ i % width, i / width }) != 0)
+			clueCount++;
+	}
+
+	WriteVarint(stream, width);
+	WriteVarint(stream, height);
+	WriteVarint(stream, clueCount);
+
+	int previousIndex = 0;
+	for (int i = 0; i < width * height; i++)
+	{
+		int size = puzzle.GetRequiredSize({ i % width, i / width });
+		if (size == 0)
+			continue;
+
+		WriteVarint(stream, i - previousIndex);
+		WriteVarint(stream, size);
+		previousIndex = i;
+	}
+
+	stream.put((char)(solution ? Pack::HasSolution : 0));
+
+	if (solution)
+	{
+		std::vector<uint8_t> mask((width * height + 7) / 8, 0);
+		for (int i = 0; i < width * height; i++)
+		{
+			if (solution->IsBlack({ i % width, i / width }))
+				mask[i / 8] |= 1 << (i % 8);
+		}
+		stream.write((const char*)mask.data(), mask.size());
+	}
+
+	return (bool)stream;
+}
+
+bool PackWriter::Close()
+{
+	if (!stream.is_open())
+		return false;
+
+	uint64_t indexOffset = (uint64_t)stream.tellp();
+	for (auto offset : offsets)
+		WriteInteger<uint64_t>(stream, offset);
+
+	stream.seekp(0);
+	WriteHeader(stream, (uint32_t)offsets.size(), indexOffset);
+
+	bool isValid = (bool)stream;
+	stream.close();
+	return isValid;
+}
+
+bool PackReader::Open(const char* filename)
+{
+	stream.open(filename, std::ios::binary);
+	if (!stream.is_open())
+		return false;
+
+	char magic[sizeof(Pack::Magic)];
+	if (!stream.read(magic, sizeof(magic)) || std::memcmp(magic, Pack::Magic, sizeof(magic)) != 0)
+		return false;
+
+	if (stream.get() != Pack::Version)
+		return false;
+
+	stream.ignore(3);
+	return ReadInteger(stream, count) && ReadInteger(stream, indexOffset);
+}
+
+bool PackReader::Read(int id, Board& puzzle, Board* solution, bool* hasSolution)
+{
+	if (id < 0 || id >= count)
+		return false;
+
+	uint64_t offset;
+	stream.clear();
+	stream.seekg(indexOffset + (uint64_t)id * sizeof(uint64_t));
+	if (!ReadInteger(stream, offset))
+		return false;
+
+	stream.seekg(offset);
+
+	uint64_t width, height, clueCount;
+	if (!ReadVarint(stream, width) || !ReadVarint(stream, height) || !ReadVarint(stream, clueCount))
+		return false;
+
+	// a square index has to fit into an int
+	if (width == 0 || height == 0 || width > 0xffff || height > 0xffff || width * height > 0x7fffffff)
+		return false;
+
+	// every clue needs an origin below NoOrigin
+	if (clueCount >= NoOrigin)
+		return false;
+
+	Board board((int)width, (int)height);
+
+	uint64_t index = 0;
+	for (uint64_t i = 0; i < clueCount; i++)
+	{
+		uint64_t delta, size;
+		if (!ReadVarint(stream, delta) || !ReadVarint(stream, size))
+			return false;
+
+		index += delta;
+		if (index >= width * height || size == 0 || size > MaxSquareValue)
+			return false;
+
+		Point pt = { (int)(index % width), (int)(index / width) };
+		board.SetWhite(pt);
+		board.SetSize(pt, (int)size);
+	}
+
+	int flags = stream.get();
+	if (flags == std::char_traits<char>::eof())
+		return false;
+
+	if (hasSolution)
+		*hasSolution = (flags & Pack::HasSolution) != 0;
+
+	if (solution && (flags & Pack::HasSolution))
+	{
+		std::vector<uint8_t> mask((width * height + 7) / 8);
+		if (!stream.read((char*)mask.data(), mask.size()))
+			return false;
+
+		*solution = board;
+		for (int i = 0; i < width * height; i++)
+		{
+			Point pt = { (int)(i % width), (int)(i / width) };
+			if (mask[i / 8] & (1 << (i % 8)))
+				solution->SetBlack(pt);
+			else
+				solution->SetWhite(pt);
+		}
+	}
+
+	puzzle = std::move(board);
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+#include "NurikabeBoard.h"
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+namespace Nurikabe
+{
+	// Binary pack of puzzles and their solutions. All integers are little endian.
+	//
+	//   header   "NKPK", u8 version, 3 reserved bytes, u32 puzzle count, u64 index offset
+	//   puzzles  varint width, varint height, varint clue count,
+	//            clues as (varint index delta, varint size) where index is y * width + x
+	//            and delta is from the previous clue, u8 flags,
+	//            if flags & HasSolution: 1 bit per square, set when black, first square in lowest bit
+	//   index    u64 offset of every puzzle, so a puzzle can be read by its ID alone
+	namespace Pack
+	{
+		constexpr char Magic[4] = { 'N', 'K', 'P', 'K' };
+		constexpr uint8_t Version = 1;
+		constexpr int HeaderSize = 20;
+
+		constexpr uint8_t HasSolution = 1;
+	}
+
+	class PackWriter
+	{
+		std::ofstream stream;
+		std::vector<uint64_t> offsets;
+
+	public:
+		~PackWriter();
+
+		bool Open(const char* filename);
+
+		/// @brief Appends @p puzzle and optionally its @p solution , where every square that is not black is white.
+		bool Add(const Board& puzzle, const Board* solution = nullptr);
+
+		/// @brief Writes the index, pack is not valid before this is called.
+		bool Close();
+	};
+
+	class PackReader
+	{
+		std::ifstream stream;
+		uint32_t count = 0;
+		uint64_t indexOffset = 0;
+
+	public:
+		bool Open(const char* filename);
+
+		int GetCount() const { return (int)count; }
+
+		/// @brief Reads puzzle @p id . When @p solution is given it receives the solution, or is left untouched when the pack has none and false is written to @p hasSolution .
+		bool Read(int id, Board& puzzle, Board* solution = nullptr, bool* hasSolution = nullptr);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "NurikabePatterns.h"
+
+using namespace Nurikabe;
+using namespace Nurikabe::Patterns;
+
+enum Side
+{
+	Left,
+	Right,
+	Up,
+	Down
+};
+
+enum Corner
+{
+	UpLeft,
+	UpRight,
+	DownLeft,
+	DownRight
+};
+
+static constexpr int GetNeighbour(int index, int side)
+{
+	return (index >> (side * 3)) & 7;
+}
+
+static constexpr Entry MakeEntry(int index)
+{
+	Entry entry;
+
+	// a 2x2 of black that only misses this square and the corner between two black neighbours
+	constexpr int pools[4][2] = { { Left, Up }, { Right, Up }, { Left, Down }, { Right, Down } };
+	for (int corner = UpLeft; corner <= DownRight; corner++)
+	{
+		if (GetNeighbour(index, pools[corner][0]) == Black && GetNeighbour(index, pools[corner][1]) == Black)
+			entry.poolCorners |= 1 << corner;
+	}
+
+	// white here would join two islands
+	bool mustBeBlack = false;
+	int island = -1;
+	for (int side = Left; side <= Down; side++)
+	{
+		int neighbour = GetNeighbour(index, side);
+		if (neighbour < Island)
+			continue;
+
+		if (island >= 0 && island != neighbour)
+			mustBeBlack = true;
+		island = neighbour;
+	}
+
+	// white here could not reach any clue
+	bool isClosed = true;
+	for (int side = Left; side <= Down; side++)
+	{
+		int neighbour = GetNeighbour(index, side);
+		if (neighbour != Black && neighbour != Wall)
+			isClosed = false;
+	}
+
+	if (mustBeBlack || isClosed)
+		entry.outcome = Outcome::Black;
+
+	return entry;
+}
+
+static constexpr std::array<Entry, IndexCount> MakeTable()
+{
+	std::array<Entry, IndexCount> table = {};
+	for (int index = 0; index < IndexCount; index++)
+		table[index] = MakeEntry(index);
+	return table;
+}
+
+static constexpr std::array<Entry, IndexCount> table = MakeTable();
+
+static constexpr int MakeIndex(int left, int right, int up, int down)
+{
+	return left | right << 3 | up << 6 | down << 9;
+}
+
+static_assert(table[MakeIndex(Black, Unknown, Black, Unknown)].poolCorners == 1 << UpLeft);
+static_assert(table[MakeIndex(Black, Black, Black, Black)].poolCorners == 0xF);
+static_assert(table[MakeIndex(Island, Island + 1, Unknown, Unknown)].outcome == Outcome::Black);
+static_assert(table[MakeIndex(Island, Unknown, Island, White)].outcome == Outcome::None);
+static_assert(table[MakeIndex(Wall, Black, Wall, Black)].outcome == Outcome::Black);
+static_assert(table[MakeIndex(Wall, White, Wall, Black)].outcome == Outcome::None);
+
+const std::array<Entry, IndexCount> Patterns::Table = table;
+
+Outcome Patterns::Deduce(const Board& board, const Point& pt)
+{
+	const Point neighbours[] = { pt.Left(), pt.Right(), pt.Up(), pt.Down() };
+	const Point corners[] = { { pt.x - 1, pt.y - 1 }, { pt.x + 1, pt.y - 1 }, { pt.x - 1, pt.y + 1 }, { pt.x + 1, pt.y + 1 } };
+
+	int index = 0;
+
+	SquareValue origins[4];
+	int originCount = 0;
+	for (int side = Left; side <= Down; side++)
+	{
+		int neighbour = Wall;
+		if (board.IsValidPosition(neighbours[side]))
+		{
+			const Square& square = board.Get(neighbours[side]);
+			switch (square.GetState())
+			{
+			case SquareState::Black:
+				neighbour = Black;
+				break;
+			case SquareState::Wall:
+				break;
+			case SquareState::White:
+			{
+				SquareValue origin = square.GetOrigin();
+				if (origin == NoOrigin)
+				{
+					neighbour = White;
+					break;
+				}
+
+				int number = 0;
+				while (number < originCount && origins[number] != origin)
+					number++;
+				if (number == originCount)
+					origins[originCount++] = origin;
+				neighbour = Island + number;
+				break;
+			}
+			default:
+				neighbour = Unknown;
+				break;
+			}
+		}
+		index |= neighbour << (side * 3);
+	}
+
+	const Entry& entry = Table[index];
+
+	int blackCorners = 0;
+	for (int corner = UpLeft; corner <= DownRight; corner++)
+	{
+		if ((entry.poolCorners >> corner & 1) && board.IsValidPosition(corners[corner]) && board.Get(corners[corner]).GetState() == SquareState::Black)
+			blackCorners |= 1 << corner;
+	}
+
+	if (!blackCorners)
+		return entry.outcome;
+
+	return entry.outcome == Outcome::Black ? Outcome::Contradiction : Outcome::White;
+}
\ No newline at end of file
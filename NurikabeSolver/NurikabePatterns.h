@@ -0,0 +1,58 @@
+#pragma once
+#include "NurikabeBoard.h"
+#include <array>
+#include <cstdint>
+
+namespace Nurikabe
+{
+	// Deductions about an unknown square that follow from the 3x3 squares around
+	// it alone, looked up in a table built at compile time.
+	//
+	// The table is indexed by the left, right, up and down neighbour, 3 bits each,
+	// see Neighbour. Islands are numbered in the order they are met among the four,
+	// so two neighbours have the same number exactly when they belong to the same
+	// island. Diagonal neighbours only matter when they are black, an entry holds
+	// which of them would complete a 2x2 of black, so they are checked with a single
+	// mask and the table stays small enough for the cache.
+	//
+	// The table knows that three black squares of a 2x2 make the fourth white, that a
+	// square between two islands is black and that a square closed in by black and the
+	// edge of the board is black, or that it is a contradiction when both apply.
+	namespace Patterns
+	{
+		enum Neighbour : uint8_t
+		{
+			Unknown,
+			Black,
+			// outside of the board
+			Wall,
+			// white not connected to any clue yet
+			White,
+			// white of the first island met, numbers of further islands follow
+			Island
+		};
+
+		enum class Outcome : uint8_t
+		{
+			None,
+			White,
+			Black,
+			Contradiction
+		};
+
+		struct Entry
+		{
+			// when no diagonal neighbour is black
+			Outcome outcome = Outcome::None;
+			// up left, up right, down left and down right neighbour, 1 bit each
+			uint8_t poolCorners = 0;
+		};
+
+		constexpr int IndexCount = 1 << 12;
+
+		extern const std::array<Entry, IndexCount> Table;
+
+		/// @brief What the 3x3 squares around the unknown square at @p pt decide about it.
+		Outcome Deduce(const Board& board, const Point& pt);
+	}
+}
\ No newline at end of file
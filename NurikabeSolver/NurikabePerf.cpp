@@ -0,0 +1,244 @@
+#include "NurikabePerf.h"
+#include "NurikabeSolver.h"
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace Nurikabe;
+
+static const int SectionCount = (int)PerfSection::Count + Solver::PhaseCount;
+
+struct SectionCounters
+{
+	uint64_t calls = 0;
+	uint64_t values[PerfCounters::EventCount] = {};
+};
+
+static std::mutex perfMutex;
+static SectionCounters totalCounters[SectionCount];
+// events that could be opened on any thread, the others are printed as '-'
+static bool isEventOpened[PerfCounters::EventCount] = {};
+
+static void AddCounters(SectionCounters* totals, const SectionCounters* counters)
+{
+	for (int i = 0; i < SectionCount; i++)
+	{
+		totals[i].calls += counters[i].calls;
+		for (int event = 0; event < PerfCounters::EventCount; event++)
+			totals[i].values[event] += counters[i].values[event];
+	}
+}
+
+#ifdef __linux__
+
+// Events are opened as one group, so they are scheduled onto the CPU together
+// and one read returns all of them, in the order they were opened.
+struct ThreadCounters
+{
+	bool isOpened = false;
+	int leader = -1;
+	int fds[PerfCounters::EventCount];
+	// position of every event in a group read, -1 when it could not be opened
+	int positions[PerfCounters::EventCount];
+	int openedCount = 0;
+
+	SectionCounters sections[SectionCount];
+
+	ThreadCounters()
+	{
+		for (int event = 0; event < PerfCounters::EventCount; event++)
+		{
+			fds[event] = -1;
+			positions[event] = -1;
+		}
+	}
+
+	~ThreadCounters()
+	{
+		for (int event = 0; event < PerfCounters::EventCount; event++)
+			if (fds[event] >= 0)
+				close(fds[event]);
+
+		std::lock_guard<std::mutex> lock(perfMutex);
+		AddCounters(totalCounters, sections);
+	}
+
+	bool Open()
+	{
+		if (isOpened)
+			return leader >= 0;
+		isOpened = true;
+
+		const struct { uint32_t type; uint64_t config; } events[] =
+		{
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		};
+		static_assert(sizeof(events) / sizeof(*events) == PerfCounters::EventCount);
+
+		for (int event = 0; event < PerfCounters::EventCount; event++)
+		{
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = events[event].type;
+			attr.config = events[event].config;
+			attr.read_format = PERF_FORMAT_GROUP;
+			attr.disabled = leader < 0;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+
+			// counts the calling thread on any CPU
+			int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+			if (fd < 0)
+			{
+				// without cycles there is no group to add the rest to
+				if (event == PerfCounters::Cycles)
+					return false;
+				continue;
+			}
+
+			if (leader < 0)
+				leader = fd;
+			fds[event] = fd;
+			positions[event] = openedCount++;
+		}
+
+		ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+		std::lock_guard<std::mutex> lock(perfMutex);
+		for (int event = 0; event < PerfCounters::EventCount; event++)
+			if (positions[event] >= 0)
+				isEventOpened[event] = true;
+
+		return true;
+	}
+
+	bool Read(uint64_t* values) const
+	{
+		uint64_t buffer[1 + PerfCounters::EventCount];
+		if (read(leader, buffer, sizeof(buffer)) < (ssize_t)((1 + openedCount) * sizeof(uint64_t)))
+			return false;
+
+		for (int event = 0; event < PerfCounters::EventCount; event++)
+			values[event] = positions[event] >= 0 ? buffer[1 + positions[event]] : 0;
+		return true;
+	}
+};
+
+static thread_local ThreadCounters threadCounters;
+
+bool PerfCounters::Enable()
+{
+	if (!threadCounters.Open())
+		return false;
+
+	isEnabled = true;
+	return true;
+}
+
+bool PerfCounters::Begin(uint64_t* values)
+{
+	return threadCounters.Open() && threadCounters.Read(values);
+}
+
+void PerfCounters::End(int section, const uint64_t* start)
+{
+	uint64_t values[EventCount];
+	if (!threadCounters.Read(values))
+		return;
+
+	auto& counters = threadCounters.sections[section];
+	counters.calls++;
+	for (int event = 0; event < EventCount; event++)
+		counters.values[event] += values[event] - start[event];
+}
+
+static void AddThreadCounters(SectionCounters* totals)
+{
+	AddCounters(totals, threadCounters.sections);
+}
+
+#else
+
+bool PerfCounters::Enable()
+{
+	return false;
+}
+
+bool PerfCounters::Begin(uint64_t* values)
+{
+	return false;
+}
+
+void PerfCounters::End(int section, const uint64_t* start)
+{
+}
+
+static void AddThreadCounters(SectionCounters* totals)
+{
+}
+
+#endif
+
+void PerfCounters::Print(std::ostream& stream)
+{
+	SectionCounters sections[SectionCount];
+	bool isPrinted[EventCount];
+	{
+		std::lock_guard<std::mutex> lock(perfMutex);
+		for (int i = 0; i < SectionCount; i++)
+			sections[i] = totalCounters[i];
+		for (int event = 0; event < EventCount; event++)
+			isPrinted[event] = isEventOpened[event];
+	}
+	AddThreadCounters(sections);
+
+	char line[256];
+	std::snprintf(line, sizeof(line), "  %-44s %10s %14s %14s %6s %12s %12s %12s\n",
+		"section", "calls", "cycles", "instructions", "IPC", "L1D misses", "LLC misses", "br misses");
+	stream << "Hardware counters:" << '\n' << line;
+
+	for (int i = 0; i < SectionCount; i++)
+	{
+		std::string name;
+		if (i == (int)PerfSection::UpdateContiguousRegions)
+			name = "UpdateContiguousRegions";
+		else if (i == (int)PerfSection::SolverCopies)
+			name = "Solver copies";
+		else
+			name = std::to_string(i - (int)PerfSection::Count) + " " + Solver::GetPhaseName(i - (int)PerfSection::Count);
+
+		// events that could not be opened are not mistaken for zero
+		const auto& counters = sections[i];
+		char values[EventCount][32];
+		for (int event = 0; event < EventCount; event++)
+		{
+			if (isPrinted[event])
+				std::snprintf(values[event], sizeof(values[event]), "%llu", (unsigned long long)counters.values[event]);
+			else
+				std::snprintf(values[event], sizeof(values[event]), "-");
+		}
+
+		char ipc[32] = "-";
+		if (isPrinted[Instructions] && counters.values[Cycles] > 0)
+			std::snprintf(ipc, sizeof(ipc), "%.2f", (double)counters.values[Instructions] / counters.values[Cycles]);
+
+		std::snprintf(line, sizeof(line), "  %-44s %10llu %14s %14s %6s %12s %12s %12s\n",
+			name.c_str(), (unsigned long long)counters.calls, values[Cycles], values[Instructions], ipc,
+			values[L1DMisses], values[LLCMisses], values[BranchMisses]);
+		stream << line;
+	}
+}
\ No newline at end of file
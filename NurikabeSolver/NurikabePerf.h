@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace Nurikabe
+{
+	// parts of the solver counted besides the rules of Solver::SolvePhase
+	enum class PerfSection
+	{
+		UpdateContiguousRegions,
+		// solvers copied to guess, and restored when a guess turned out right
+		SolverCopies,
+		Count
+	};
+
+	// Hardware counters of the CPU, opened with perf_event_open on Linux, so
+	// cycles, instructions, cache misses and branch misses can be told apart for
+	// every rule. Every thread opens its own counters the first time it counts
+	// and adds them to the totals when it ends. Nothing is counted until Enable
+	// succeeds, a PerfScope costs a check of a flag until then.
+	class PerfCounters
+	{
+	public:
+		enum Event
+		{
+			Cycles,
+			Instructions,
+			L1DMisses,
+			LLCMisses,
+			BranchMisses,
+			EventCount
+		};
+
+		static inline std::atomic<bool> isEnabled = false;
+
+		/// @brief Starts counting, false when the counters cannot be opened, like on other systems or when perf_event_paranoid forbids it.
+		static bool Enable();
+
+		/// @brief Prints the counters of every section. Threads that are still running only contribute when it is the calling thread.
+		static void Print(std::ostream& stream);
+
+		/// @brief Reads the counters of the calling thread, false when they cannot be opened on it.
+		static bool Begin(uint64_t* values);
+		static void End(int section, const uint64_t* start);
+	};
+
+	// Counts the events between construction and destruction towards a
+	// section. Scopes can be nested, the outer one includes the inner ones.
+	class PerfScope
+	{
+		int section;
+		bool isCounting;
+		uint64_t start[PerfCounters::EventCount];
+
+	public:
+		explicit PerfScope(PerfSection section)
+			: PerfScope((int)section)
+		{
+		}
+
+		/// @brief Counts towards rule @p phase of Solver::SolvePhase.
+		static PerfScope Phase(int phase)
+		{
+			return PerfScope((int)PerfSection::Count + phase);
+		}
+
+		~PerfScope()
+		{
+			if (isCounting)
+				PerfCounters::End(section, start);
+		}
+
+		PerfScope(const PerfScope&) = delete;
+		PerfScope& operator=(const PerfScope&) = delete;
+
+	private:
+		explicit PerfScope(int section)
+			: section(section)
+			, isCounting(PerfCounters::isEnabled.load(std::memory_order_relaxed) && PerfCounters::Begin(start))
+		{
+		}
+	};
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "NurikabeRegion.h"
 #include "NurikabeBoard.h"
+#include "NurikabeAllocations.h"
 #include <assert.h>
 
 using namespace Nurikabe;
@@ -25,7 +26,7 @@ bool Region::IsSameState() const
 
 bool Region::IsSameOrigin() const
 {
-	uint8_t invalidVal = ~0;
+	SquareValue invalidVal = NoOrigin;
 
 	if (squares.size() == 0)
 		return invalidVal;
@@ -104,9 +105,9 @@ void Region::SetState(SquareState state) const
 
 }
 
-uint8_t Region::GetSameSize() const
+SquareValue Region::GetSameSize() const
 {
-	uint8_t invalidVal = 0;
+	SquareValue invalidVal = 0;
 
 	if (squares.size() == 0)
 		return invalidVal;
@@ -128,7 +129,7 @@ uint8_t Region::GetSameSize() const
 	return val;
 }
 
-void Region::SetSize(uint8_t size) const
+void Region::SetSize(SquareValue size) const
 {
 	for (int i = 0; i < squares.size(); i++)
 	{
@@ -136,9 +137,9 @@ void Region::SetSize(uint8_t size) const
 	}
 }
 
-uint8_t Region::GetSameOrigin() const
+SquareValue Region::GetSameOrigin() const
 {
-	uint8_t invalidVal = ~0;
+	SquareValue invalidVal = NoOrigin;
 
 	if (squares.size() == 0)
 		return invalidVal;
@@ -160,7 +161,7 @@ uint8_t Region::GetSameOrigin() const
 	return val;
 }
 
-void Region::SetOrigin(uint8_t origin) const
+void Region::SetOrigin(SquareValue origin) const
 {
 	for (int i = 0; i < squares.size(); i++)
 	{
@@ -191,7 +192,7 @@ bool Region::Contains(const Point& pt) const
 void Region::FixWhites()
 {
 	auto origin = GetSameOrigin();
-	if (origin != (uint8_t)~0)
+	if (origin != NoOrigin)
 		SetOrigin(origin);
 	
 	auto size = GetSameSize();
@@ -212,11 +213,13 @@ Region::Region(Board* board)
 Region::Region(Board* board, std::vector<Point> squares)
 {
 	this->board = board;
-	this->squares = squares;
+	this->squares = std::move(squares);
 }
 
 Region::Region(Board* board, const Point& square)
 {
+	TRACK_ALLOCATIONS(AllocationCategory::Region);
+
 	this->board = board;
 	this->squares.push_back(square);
 }
@@ -232,6 +235,8 @@ void Region::ForEach(const PointSquareDelegate& callback) const
 
 void Region::ForEachContiguousRegion(const RegionDelegate& callback) const
 {
+	TRACK_ALLOCATIONS(AllocationCategory::Region);
+
 	Region handled(board);
 
 	ForEach([this, &handled, &callback](const Point& pt, const Square&)
@@ -251,6 +256,8 @@ void Region::ForEachContiguousRegion(const RegionDelegate& callback) const
 
 Nurikabe::Region Region::Union(const Region& a, const Region& b)
 {
+	TRACK_ALLOCATIONS(AllocationCategory::Region);
+
 	if (a.GetBoard() != b.GetBoard())
 		return Region(nullptr);
 
@@ -265,6 +272,8 @@ Nurikabe::Region Region::Union(const Region& a, const Region& b)
 
 Nurikabe::Region& Region::Append(const Region& other)
 {
+	TRACK_ALLOCATIONS(AllocationCategory::Region);
+
 	assert(GetBoard() == other.GetBoard());
 
 	for (int i = 0; i < other.GetSquareCount(); i++)
@@ -276,6 +285,8 @@ Nurikabe::Region& Region::Append(const Region& other)
 
 Region Region::Intersection(const Region& a, const Region& b)
 {
+	TRACK_ALLOCATIONS(AllocationCategory::Region);
+
 	if (a.GetBoard() != b.GetBoard())
 		return Region(nullptr);
 
@@ -296,6 +307,8 @@ Region Region::Intersection(const Region& a, const Region& b)
 
 Region Region::Subtract(const Region& a, const Region& b)
 {
+	TRACK_ALLOCATIONS(AllocationCategory::Region);
+
 	if (a.GetBoard() != b.GetBoard())
 		return Region(nullptr);
 
@@ -313,6 +326,8 @@ Region Region::Subtract(const Region& a, const Region& b)
 
 Region Region::Neighbours(const PointSquareDelegate& predicate, bool includeWalls) const
 {
+	TRACK_ALLOCATIONS(AllocationCategory::Region);
+
 	Region ret(board);
 	auto AddIfNewAndValid = [this, &ret, &predicate, &includeWalls](const Point& pt)
 	{
@@ -347,6 +362,8 @@ Region Region::Neighbours(const PointSquareDelegate& predicate, bool includeWall
 
 Region& Region::ExpandSingleInline(const PointSquareDelegate& predicate, bool includeWalls)
 {
+	TRACK_ALLOCATIONS(AllocationCategory::Region);
+
 	auto AddIfNewAndValid = [this, &predicate, &includeWalls](const Point& pt)
 	{
 		// ignore squares not on the board
@@ -377,6 +394,8 @@ Region& Region::ExpandSingleInline(const PointSquareDelegate& predicate, bool in
 
 Region& Region::ExpandAllInline(const PointSquareDelegate& predicate)
 {
+	TRACK_ALLOCATIONS(AllocationCategory::Region);
+
 	int sqCount = GetSquareCount();
 	while (true)
 	{
@@ -397,7 +416,7 @@ bool Region::StartNeighbourSpill(Square& out) const
 
 	auto origin = GetSameOrigin();
 	auto size = GetSameSize();
-	if (origin == (uint8_t)~0)
+	if (origin == NoOrigin)
 		size = GetSquareCount();
 
 	auto sq = Square(GetState(), size);
@@ -409,6 +428,8 @@ bool Region::StartNeighbourSpill(Square& out) const
 
 Region Region::NeighbourSpill(const Square& sq) const
 {
+	TRACK_ALLOCATIONS(AllocationCategory::Region);
+
 	auto direct = Neighbours([this, &sq](const Point& pt, const Square& sqInner)
 	{
 		if (sq.GetState() == SquareState::Black)
@@ -419,11 +440,11 @@ Region Region::NeighbourSpill(const Square& sq) const
 		}
 		else if (sq.GetState() == SquareState::White)
 		{
-			if (sq.GetOrigin() == (uint8_t)~0)
+			if (sq.GetOrigin() == NoOrigin)
 			{
 				if (sqInner.GetState() == SquareState::White)
 				{
-					if (sqInner.GetOrigin() == (uint8_t)~0)
+					if (sqInner.GetOrigin() == NoOrigin)
 						return true;
 						
 					auto whiteActualSize =
@@ -441,7 +462,7 @@ Region Region::NeighbourSpill(const Square& sq) const
 						if (sqInner.GetState() != SquareState::White)
 							return false;
 
-						if (sqInner.GetOrigin() == (uint8_t)~0)
+						if (sqInner.GetOrigin() == NoOrigin)
 							return false;
 
 						auto whiteActualSize =
@@ -462,7 +483,7 @@ Region Region::NeighbourSpill(const Square& sq) const
 			{
 				if (sqInner.GetState() == SquareState::White)
 				{
-					if (sqInner.GetOrigin() == sq.GetOrigin() || sqInner.GetOrigin() == (uint8_t)~0)
+					if (sqInner.GetOrigin() == sq.GetOrigin() || sqInner.GetOrigin() == NoOrigin)
 					{
 						return true;
 					}
@@ -474,7 +495,7 @@ Region Region::NeighbourSpill(const Square& sq) const
 						if (sqInner.GetState() != SquareState::White)
 							return false;
 						
-						if (sqInner.GetOrigin() != (uint8_t)~0)
+						if (sqInner.GetOrigin() != NoOrigin)
 						{
 							if (sqInner.GetOrigin() == sq.GetOrigin())
 								return false;
@@ -506,7 +527,7 @@ Region Region::NeighbourSpill(const Square& sq) const
 		return true;
 	});
 
-	if (sq.GetOrigin() == (uint8_t)~0 && sq.GetState() == SquareState::White && direct.GetSquareCount() > 1 && !direct.IsContiguous())
+	if (sq.GetOrigin() == NoOrigin && sq.GetState() == SquareState::White && direct.GetSquareCount() > 1 && !direct.IsContiguous())
 	{
 		Region removeFromDirect = Region((Board*)GetBoard());
 
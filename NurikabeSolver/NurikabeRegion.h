@@ -34,11 +34,11 @@ namespace Nurikabe
 		// set state of all squares in this region
 		void SetState(SquareState state) const;
 		
-		uint8_t GetSameSize() const;
-		void SetSize(uint8_t size) const;
+		SquareValue GetSameSize() const;
+		void SetSize(SquareValue size) const;
 
-		uint8_t GetSameOrigin() const;
-		void SetOrigin(uint8_t size) const;
+		SquareValue GetSameOrigin() const;
+		void SetOrigin(SquareValue size) const;
 
 		friend bool operator==(const Region& a, const Region& b);
 
@@ -0,0 +1,120 @@
+// Replays a log written by NurikabeSolver --log onto the puzzles it was
+// written for and checks every puzzle ends up solved, without running any rule
+// of the solver. Puzzles have to be given in the same order as when solving.
+// Usage: NurikabeReplay <log> -f <filename1> [filename2] ...
+
+#include "Nurikabe.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Replays the log of one puzzle, returns false when it does not lead to a solution.
+static bool ReplayPuzzle(Nurikabe::DeductionLogReader& reader, const std::string& name, const Nurikabe::Board& board)
+{
+	Nurikabe::DeductionReplay replay;
+
+	auto timeStart = std::chrono::steady_clock::now();
+	bool isSolved = reader.Replay(board, replay);
+	double runtimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - timeStart).count();
+
+	if (!isSolved)
+	{
+		std::cout << "Failed '" << name << "': " << replay.error << '\n';
+		return false;
+	}
+
+	char line[256];
+	std::snprintf(line, sizeof(line), "Solved '%s': %d of %d logged squares replayed, %d guesses, %d backtracks, %.3f ms\n",
+		name.c_str(), replay.replayedCount, replay.decidedCount, replay.guessCount, replay.backtrackCount, runtimeMs);
+	std::cout << line;
+	return true;
+}
+
+int main(int argc, const char** argv)
+{
+	using namespace Nurikabe;
+
+	const char* logFilename = nullptr;
+	std::vector<const char*> filenames;
+
+	bool isFilename = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (isFilename)
+			filenames.push_back(argv[i]);
+		else if (!std::strcmp(argv[i], "-f"))
+			isFilename = true;
+		else
+			logFilename = argv[i];
+	}
+
+	if (!logFilename || filenames.empty())
+	{
+		std::cout << "Usage: NurikabeReplay <log> -f <filename1> [filename2] ..." << '\n';
+		return 0;
+	}
+
+	DeductionLogReader reader;
+	if (!reader.Open(logFilename))
+	{
+		std::cout << "Failed to read log '" << logFilename << "'" << '\n';
+		return 1;
+	}
+
+	int failCount = 0;
+	for (const char* filename : filenames)
+	{
+		PackReader pack;
+		if (pack.Open(filename))
+		{
+			for (int puzzle = 0; puzzle < pack.GetCount(); puzzle++)
+			{
+				Board board;
+				if (!pack.Read(puzzle, board))
+				{
+					std::cout << "Failed to read puzzle #" << puzzle << " of '" << filename << "'" << '\n';
+					return 1;
+				}
+
+				if (!ReplayPuzzle(reader, std::string(filename) + " #" + std::to_string(puzzle), board))
+					failCount++;
+			}
+			continue;
+		}
+
+		Corpus corpus;
+		if (!corpus.Open(filename))
+		{
+			std::cout << "Failed to read '" << filename << "'" << '\n';
+			return 1;
+		}
+
+		for (int puzzle = 0; puzzle < corpus.GetCount(); puzzle++)
+		{
+			Board board;
+			if (!corpus.Load(puzzle, board))
+			{
+				std::cout << "Failed to read puzzle #" << puzzle << " of '" << filename << "'" << '\n';
+				return 1;
+			}
+
+			std::string name = filename;
+			if (corpus.GetCount() > 1)
+				name += " #" + std::to_string(puzzle);
+
+			if (!ReplayPuzzle(reader, name, board))
+				failCount++;
+		}
+	}
+
+	// puzzles missing from the command line would leave logs unchecked
+	if (!reader.IsAtEnd())
+	{
+		std::cout << "Log holds more puzzles than were given" << '\n';
+		failCount++;
+	}
+
+	return failCount;
+}
\ No newline at end of file
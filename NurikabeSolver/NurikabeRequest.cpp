@@ -0,0 +1,231 @@
+#include "NurikabeRequest.h"
+#include "NurikabeJson.h"
+#include <chrono>
+#include <cstdio>
+
+using namespace Nurikabe;
+
+bool Request::Parse(std::string_view line, std::string& error)
+{
+	JsonReader reader{ line };
+
+	if (!reader.Consume('{'))
+	{
+		error = "expected a JSON object";
+		return false;
+	}
+
+	bool hasGrid = false;
+	bool isFirst = true;
+	while (!reader.Consume('}'))
+	{
+		if (!isFirst && !reader.Consume(','))
+		{
+			error = "expected ',' between members";
+			return false;
+		}
+		isFirst = false;
+
+		std::string key;
+		if (!reader.ReadString(key) || !reader.Consume(':'))
+		{
+			error = "expected a member name";
+			return false;
+		}
+
+		if (key == "grid")
+		{
+			if (!reader.ReadString(grid))
+			{
+				error = "'grid' has to be a string";
+				return false;
+			}
+			hasGrid = true;
+			continue;
+		}
+
+		std::string_view raw;
+		if (!reader.ReadRaw(raw))
+		{
+			error = "invalid value of '" + key + "'";
+			return false;
+		}
+
+		if (key == "id")
+		{
+			id = std::string(raw);
+		}
+		else if (key == "maxIterations")
+		{
+			if (std::sscanf(std::string(raw).c_str(), "%d", &maxIterations) != 1)
+			{
+				error = "'maxIterations' has to be a number";
+				return false;
+			}
+		}
+
+		else if (key == "deadlineMs")
+		{
+			double deadlineMs;
+			if (std::sscanf(std::string(raw).c_str(), "%lf", &deadlineMs) != 1)
+			{
+				error = "'deadlineMs' has to be a number";
+				return false;
+			}
+
+			auto duration = std::chrono::duration<double, std::milli>(deadlineMs);
+			deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration);
+		}
+
+		// unknown members are ignored
+	}
+
+	if (!hasGrid)
+	{
+		error = "missing 'grid'";
+		return false;
+	}
+
+	return true;
+}
+
+void Result::Write(std::string& out, std::string_view rawId) const
+{
+	out += "{\"id\":";
+	out += rawId;
+
+	out += ",\"status\":";
+	switch (status)
+	{
+	case Status::Solved: out += "\"solved\""; break;
+	case Status::Unsolved: out += "\"unsolved\""; break;
+	case Status::Error: out += "\"error\""; break;
+	}
+
+	if (status == Status::Error)
+	{
+		out += ",\"error\":";
+		AppendJsonString(out, error);
+		out += "}\n";
+		return;
+	}
+
+	if (status == Status::Solved)
+	{
+		out += ",\"width\":";
+		out += std::to_string(solution.GetWidth());
+		out += ",\"height\":";
+		out += std::to_string(solution.GetHeight());
+
+		out += ",\"solution\":\"";
+		for (int y = 0; y < solution.GetHeight(); y++)
+		{
+			for (int x = 0; x < solution.GetWidth(); x++)
+				out.push_back(solution.IsBlack({ x, y }) ? '1' : '0');
+		}
+		out.push_back('"');
+
+		if (isCached)
+			out += ",\"cached\":true";
+	}
+
+	char numbers[64];
+	std::snprintf(numbers, sizeof(numbers), ",\"iterations\":%d,\"runtimeMs\":%.3f", iterations, runtimeMs);
+	out += numbers;
+
+	if (queueMs >= 0.0)
+	{
+		std::snprintf(numbers, sizeof(numbers), ",\"queueMs\":%.3f", queueMs);
+		out += numbers;
+	}
+
+	out += "}\n";
+}
+
+Result Nurikabe::SolveBoard(const Board& puzzle, const Solver::SolveSettings& settings, SolutionCache* cache, Observer* observer)
+{
+	Result result;
+
+	auto timeStart = std::chrono::steady_clock::now();
+
+	if (cache && cache->Find(puzzle, result.solution))
+	{
+		result.status = Result::Status::Solved;
+		result.isCached = true;
+		result.runtimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - timeStart).count();
+		return result;
+	}
+
+	AllocationTracker tracker;
+
+	Solver solver(puzzle, &result.iterations);
+	solver.SetObserver(observer);
+	bool isSolved = solver.Solve(settings);
+
+	result.allocations = tracker.GetStats();
+
+	auto timeStop = std::chrono::steady_clock::now();
+	result.runtimeMs = std::chrono::duration<double, std::milli>(timeStop - timeStart).count();
+
+	result.status = isSolved ? Result::Status::Solved : Result::Status::Unsolved;
+	if (isSolved)
+	{
+		result.solution = solver.GetBoard();
+		if (cache)
+			cache->Add(puzzle, result.solution);
+	}
+
+	return result;
+}
+
+Result Nurikabe::SolveRequest(const Request& request, Solver::SolveSettings settings, SolutionCache* cache)
+{
+	Board board;
+	if (!board.Load(request.grid.data(), request.grid.size()))
+	{
+		Result result;
+		result.id = request.id;
+		result.status = Result::Status::Error;
+		result.error = "invalid grid";
+		return result;
+	}
+
+	if (request.maxIterations >= 0)
+		settings.stopAtIteration = request.maxIterations;
+
+	if (request.deadline < settings.deadline)
+		settings.deadline = request.deadline;
+
+	Result result = SolveBoard(board, settings, cache);
+	result.id = request.id;
+	return result;
+}
+
+void Nurikabe::AppendJsonString(std::string& out, std::string_view value)
+{
+	out.push_back('"');
+	for (char c : value)
+	{
+		switch (c)
+		{
+		case '"': out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\n': out += "\\n"; break;
+		case '\r': out += "\\r"; break;
+		case '\t': out += "\\t"; break;
+		default:
+			if ((unsigned char)c < 0x20)
+			{
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				out += escaped;
+			}
+			else
+			{
+				out.push_back(c);
+			}
+			break;
+		}
+	}
+	out.push_back('"');
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "NurikabeAllocations.h"
+#include "NurikabeSolutionCache.h"
+#include "NurikabeSolver.h"
+#include <chrono>
+#include <string>
+#include <string_view>
+
+namespace Nurikabe
+{
+	// A puzzle to solve, one JSON object per line:
+	//   {"id": "abc", "grid": "2 5  \n     \n...", "maxIterations": 1000, "deadlineMs": 50}
+	// `grid` uses the same format as puzzle files, `id` can be any JSON value
+	// and is returned as is, `maxIterations` and `deadlineMs` are optional. The
+	// deadline counts from when the request was parsed.
+	struct Request
+	{
+		std::string id = "null";
+		std::string grid;
+		int maxIterations = -1;
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+		/// @brief Parses a single line, @p error describes what is wrong with it on failure.
+		bool Parse(std::string_view line, std::string& error);
+	};
+
+	// Outcome of a request, written as one JSON object per line:
+	//   {"id": "abc", "status": "solved", "width": 5, "height": 5, "solution": "10010...",
+	//    "iterations": 52, "runtimeMs": 1.5, "queueMs": 0.2}
+	// `solution` has one character per square row by row, '1' for black. It is
+	// present only when solved, "cached": true marks solutions taken from the
+	// solution cache without solving. `queueMs` is the time spent waiting for a free
+	// worker of the server. Failed requests have "status": "error" and "error".
+	struct Result
+	{
+		enum class Status
+		{
+			Solved,
+			Unsolved,
+			Error
+		};
+
+		std::string id = "null";
+		Status status = Status::Error;
+		std::string error;
+		Board solution;
+		bool isCached = false;
+		int iterations = 0;
+		double runtimeMs = 0.0;
+		double queueMs = -1.0;
+		// only counted when built with NURIKABE_ALLOCATIONS
+		AllocationStats allocations;
+
+		/// @brief Appends the result to @p out , terminated by a newline.
+		void Write(std::string& out) const { Write(out, id); }
+
+		/// @brief Same as Write but with @p rawId , a JSON value, in place of `id`.
+		void Write(std::string& out, std::string_view rawId) const;
+	};
+
+	/// @brief Solves @p puzzle using @p settings . Solutions are looked up in and added to @p cache when given, @p observer receives events of solving.
+	Result SolveBoard(const Board& puzzle, const Solver::SolveSettings& settings, SolutionCache* cache = nullptr, Observer* observer = nullptr);
+
+	/// @brief Solves @p request using @p settings , with the iteration limit of the request if it has one.
+	Result SolveRequest(const Request& request, Solver::SolveSettings settings, SolutionCache* cache = nullptr);
+
+	/// @brief Appends @p value to @p out as a quoted and escaped JSON string.
+	void AppendJsonString(std::string& out, std::string_view value);
+}
@@ -170,11 +170,11 @@ bool Rules::IsSolvable(const Board& board)
 			return false;
 		}
 
-		if (sq.GetState() == SquareState::White && sq.GetOrigin() == (uint8_t)~0)
+		if (sq.GetState() == SquareState::White && sq.GetOrigin() == NoOrigin)
 		{
 			Region unconnectedWhite = Region((Board*)&board, pt)
 				.ExpandAllInline([](const Point&, const Square& sqInner) {
-					return sqInner.GetState() == SquareState::White && sqInner.GetOrigin() == (uint8_t)~0;
+					return sqInner.GetState() == SquareState::White && sqInner.GetOrigin() == NoOrigin;
 				});
 
 			Region pathToConnectWhite = Region(unconnectedWhite)
@@ -184,7 +184,7 @@ bool Rules::IsSolvable(const Board& board)
 
 			Region reachableOriginTouchingWhites = pathToConnectWhite
 				.Neighbours([](const Point&, const Square& sqInner) {
-					return sqInner.GetState() == SquareState::White && sqInner.GetOrigin() != (uint8_t)~0;
+					return sqInner.GetState() == SquareState::White && sqInner.GetOrigin() != NoOrigin;
 				});
 
 			if (reachableOriginTouchingWhites.GetSquareCount() == 0)
@@ -203,7 +203,7 @@ bool Rules::IsSolvable(const Board& board)
 
 			reachableOriginTouchingWhites = pathToConnectWhite
 				.Neighbours([](const Point&, const Square& sqInner) {
-					return sqInner.GetState() == SquareState::White && sqInner.GetOrigin() != (uint8_t)~0;
+					return sqInner.GetState() == SquareState::White && sqInner.GetOrigin() != NoOrigin;
 				});
 
 			if (reachableOriginTouchingWhites.GetSquareCount() == 0)
@@ -0,0 +1,413 @@
+#include "NurikabeServer.h"
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace Nurikabe;
+
+// longest line a client can send, larger requests close the connection
+static const size_t maxRequestSize = 1 << 20;
+
+// a client that disconnects early must not kill the process while we send to it,
+// without changing how signals are handled for the program using the server
+#ifdef MSG_NOSIGNAL
+static const int sendFlags = MSG_NOSIGNAL;
+#else
+static const int sendFlags = 0;
+#endif
+
+struct Server::Connection
+{
+	int socket;
+	// received but not yet queued, can hold several requests while the queue is full
+	std::string input;
+	// nothing more is read, all of `input` still gets queued
+	bool isFinished = false;
+
+	std::mutex sendMutex;
+	// set when the client stopped taking results, later results are dropped
+	bool isStalled = false;
+
+	Connection(int socket)
+		: socket(socket)
+	{
+	}
+
+	bool IsStalled()
+	{
+		std::lock_guard<std::mutex> lock(sendMutex);
+		return isStalled;
+	}
+
+	~Connection()
+	{
+#ifndef _WIN32
+		// the last job holding the connection closes it
+		close(socket);
+#endif
+	}
+
+	void Send(const std::string& data)
+	{
+#ifndef _WIN32
+		std::lock_guard<std::mutex> lock(sendMutex);
+		if (isStalled)
+			return;
+
+		size_t sent = 0;
+		while (sent < data.size())
+		{
+			// waits at most the send timeout of the socket
+			ssize_t count = send(socket, data.data() + sent, data.size() - sent, sendFlags);
+			if (count < 0)
+			{
+				if (errno == EINTR)
+					continue;
+
+				// client went away or does not read, nobody is left to tell. Shutting
+				// down makes the event loop drop the connection too.
+				isStalled = true;
+				shutdown(socket, SHUT_RDWR);
+				return;
+			}
+			sent += count;
+		}
+#endif
+	}
+};
+
+Server::Server(const Settings& serverSettings)
+	: settings(serverSettings)
+	, listenSocket(-1)
+	, stopPipe{ -1, -1 }
+	, wakePipe{ -1, -1 }
+	, isStopping(false)
+{
+	if (settings.workerCount <= 0)
+		settings.workerCount = std::max(1, (int)std::thread::hardware_concurrency());
+
+	if (settings.queueCapacity <= 0)
+		settings.queueCapacity = 2 * settings.workerCount;
+}
+
+Server::~Server()
+{
+	Close();
+}
+
+bool Server::Open(const char* path)
+{
+	Close();
+
+#ifdef _WIN32
+	return false;
+#else
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (std::strlen(path) >= sizeof(address.sun_path))
+		return false;
+	std::strcpy(address.sun_path, path);
+
+	// socket of a previous run that was not shut down cleanly, anything else is left alone
+	struct stat fileStat;
+	if (lstat(path, &fileStat) == 0 && S_ISSOCK(fileStat.st_mode))
+		unlink(path);
+
+	listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenSocket < 0)
+		return false;
+
+	if (bind(listenSocket, (const sockaddr*)&address, sizeof(address)) != 0)
+	{
+		Close();
+		return false;
+	}
+	socketPath = path;
+
+	if (listen(listenSocket, SOMAXCONN) != 0 || pipe(stopPipe) != 0 || pipe(wakePipe) != 0)
+	{
+		Close();
+		return false;
+	}
+
+	// workers must never wait for the loop to read its wake ups
+	for (int fd : wakePipe)
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	return true;
+#endif
+}
+
+void Server::Close()
+{
+#ifndef _WIN32
+	if (listenSocket >= 0)
+		close(listenSocket);
+
+	if (!socketPath.empty())
+		unlink(socketPath.c_str());
+
+	for (int* pipeFds : { stopPipe, wakePipe })
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			if (pipeFds[i] >= 0)
+				close(pipeFds[i]);
+			pipeFds[i] = -1;
+		}
+	}
+#endif
+
+	listenSocket = -1;
+	socketPath.clear();
+}
+
+bool Server::Run()
+{
+#ifdef _WIN32
+	return false;
+#else
+	if (listenSocket < 0)
+		return false;
+
+	isStopping = false;
+	for (int i = 0; i < settings.workerCount; i++)
+		workers.emplace_back(&Server::WorkerMain, this);
+
+	std::vector<std::shared_ptr<Connection>> connections;
+	std::vector<pollfd> fds;
+	std::vector<char> buffer(64 * 1024);
+
+	// Queues the requests a connection received so far, as long as the queue has room.
+	// Returns false when the connection is done and all of its requests are queued.
+	auto QueueRequests = [this](const std::shared_ptr<Connection>& connection)
+	{
+		// results could not be sent anyway
+		if (connection->IsStalled())
+		{
+			connection->input.clear();
+			connection->isFinished = true;
+		}
+
+		size_t lineStart = 0;
+		size_t lineEnd;
+		bool hasRoom = true;
+		while ((lineEnd = connection->input.find('\n', lineStart)) != std::string::npos)
+		{
+			std::string_view line(connection->input.data() + lineStart, lineEnd - lineStart);
+			if (line.find_first_not_of(" \t\r") != std::string_view::npos)
+			{
+				Job job;
+				job.connection = connection;
+				job.request.Parse(line, job.error);
+				if (!TryPush(std::move(job)))
+				{
+					hasRoom = false;
+					break;
+				}
+			}
+			lineStart = lineEnd + 1;
+		}
+		connection->input.erase(0, lineStart);
+
+		if (hasRoom && connection->input.size() > maxRequestSize)
+		{
+			Job job;
+			job.connection = connection;
+			job.error = "request too large";
+			if (TryPush(std::move(job)))
+			{
+				connection->input.clear();
+				connection->isFinished = true;
+			}
+		}
+
+		// pending jobs keep the connection open until their results are sent
+		if (connection->isFinished && connection->input.empty())
+		{
+			shutdown(connection->socket, SHUT_RD);
+			return false;
+		}
+		return true;
+	};
+
+	while (true)
+	{
+		// requests left over from when the queue was full go first, in the order of the connections
+		for (size_t i = connections.size(); i-- > 0;)
+		{
+			if (!QueueRequests(connections[i]))
+				connections.erase(connections.begin() + i);
+		}
+
+		// with a full queue clients are not read, they wait in the kernel until a worker wakes the loop
+		const bool isReading = !IsQueueFull();
+
+		fds.clear();
+		fds.push_back({ listenSocket, POLLIN, 0 });
+		fds.push_back({ stopPipe[0], POLLIN, 0 });
+		fds.push_back({ wakePipe[0], POLLIN, 0 });
+		// connections not read are left out, a hung up client would wake poll over and over
+		for (const auto& connection : connections)
+			fds.push_back({ isReading && !connection->isFinished ? connection->socket : -1, POLLIN, 0 });
+
+		if (poll(fds.data(), fds.size(), -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if (fds[1].revents)
+			break;
+
+		if (fds[2].revents & POLLIN)
+		{
+			while (read(wakePipe[0], buffer.data(), buffer.size()) > 0)
+			{
+			}
+		}
+
+		for (size_t i = 0; i < connections.size(); i++)
+		{
+			const auto& connection = connections[i];
+			if (!(fds[i + 3].revents & (POLLIN | POLLHUP | POLLERR)))
+				continue;
+
+			ssize_t count = recv(connection->socket, buffer.data(), buffer.size(), 0);
+			if (count < 0 && errno == EINTR)
+				continue;
+
+			if (count > 0)
+				connection->input.append(buffer.data(), count);
+			else
+			{
+				// last request might be missing its newline
+				connection->input.push_back('\n');
+				connection->isFinished = true;
+			}
+		}
+
+		if (fds[0].revents & POLLIN)
+		{
+			int socket = accept(listenSocket, nullptr, nullptr);
+			if (socket >= 0)
+			{
+				timeval timeout = { settings.sendTimeoutMs / 1000, (settings.sendTimeoutMs % 1000) * 1000 };
+				setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+				int isSet = 1;
+				setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &isSet, sizeof(isSet));
+#endif
+				connections.push_back(std::make_shared<Connection>(socket));
+			}
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		isStopping = true;
+	}
+	queueNotEmpty.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+	workers.clear();
+
+	return true;
+#endif
+}
+
+void Server::Stop()
+{
+#ifndef _WIN32
+	if (stopPipe[1] >= 0)
+	{
+		char byte = 0;
+		ssize_t ignored = write(stopPipe[1], &byte, 1);
+		(void)ignored;
+	}
+#endif
+}
+
+bool Server::TryPush(Job&& job)
+{
+	job.queuedAt = std::chrono::steady_clock::now();
+
+	std::unique_lock<std::mutex> lock(queueMutex);
+	if ((int)queue.size() >= settings.queueCapacity)
+		return false;
+
+	queue.push_back(std::move(job));
+	lock.unlock();
+
+	queueNotEmpty.notify_one();
+	return true;
+}
+
+bool Server::IsQueueFull()
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+	return (int)queue.size() >= settings.queueCapacity;
+}
+
+void Server::WorkerMain()
+{
+	std::string output;
+
+	while (true)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueNotEmpty.wait(lock, [this] { return isStopping || !queue.empty(); });
+
+			// queued requests are still answered when stopping
+			if (queue.empty())
+				return;
+
+			bool wasFull = (int)queue.size() >= settings.queueCapacity;
+			job = std::move(queue.front());
+			queue.pop_front();
+
+#ifndef _WIN32
+			if (wasFull)
+			{
+				char byte = 0;
+				ssize_t ignored = write(wakePipe[1], &byte, 1);
+				(void)ignored;
+			}
+#endif
+		}
+
+		// a client that stopped taking results does not get any more solved
+		if (job.connection->IsStalled())
+			continue;
+
+		Result result;
+		if (job.error.empty())
+		{
+			auto timeStart = std::chrono::steady_clock::now();
+			result = SolveRequest(job.request, settings.solveSettings, settings.cache);
+			result.queueMs = std::chrono::duration<double, std::milli>(timeStart - job.queuedAt).count();
+		}
+		else
+		{
+			result.id = job.request.id;
+			result.error = job.error;
+		}
+
+		output.clear();
+		result.Write(output);
+		job.connection->Send(output);
+	}
+}
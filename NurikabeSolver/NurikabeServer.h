@@ -0,0 +1,96 @@
+#pragma once
+#include "NurikabeRequest.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Nurikabe
+{
+	// Solves requests from local clients connected to a Unix domain socket.
+	//
+	// Clients speak the same JSON Lines as stream mode, see NurikabeRequest.h.
+	// A client can send any number of requests on one connection, results come
+	// back as their puzzles get solved, so not necessarily in the order of the
+	// requests. A client that is done sending should shut down its writing side
+	// and read until the server closes the connection. A client sending more
+	// requests than fit into the socket buffers has to read results while it
+	// sends, a client that does not take its results within the send timeout is
+	// disconnected, so it cannot hold up the workers.
+	//
+	// Requests wait in a queue of limited size for a free worker. When the queue
+	// is full the server stops reading from clients until a worker takes the next
+	// request, so fast clients are slowed down by the kernel instead of piling up
+	// memory in the server. Stop is still noticed while the queue is full.
+	class Server
+	{
+	public:
+		struct Settings
+		{
+			// 0 picks the number of hardware threads
+			int workerCount = 0;
+			// 0 picks twice the number of workers
+			int queueCapacity = 0;
+			// used for every request, `maxIterations` of a request overrides `stopAtIteration`
+			Solver::SolveSettings solveSettings;
+			// shared by all workers, optional
+			SolutionCache* cache = nullptr;
+			// how long a worker waits for a client to take a result before dropping the client
+			int sendTimeoutMs = 5000;
+		};
+
+	private:
+		struct Connection;
+
+		struct Job
+		{
+			std::shared_ptr<Connection> connection;
+			Request request;
+			std::string error;
+			std::chrono::steady_clock::time_point queuedAt;
+		};
+
+		Settings settings;
+
+		int listenSocket;
+		int stopPipe[2];
+		// written by workers when the queue has room again, so the loop reads from clients again
+		int wakePipe[2];
+		std::string socketPath;
+
+		std::vector<std::thread> workers;
+
+		std::mutex queueMutex;
+		std::condition_variable queueNotEmpty;
+		std::deque<Job> queue;
+		bool isStopping;
+
+	public:
+		Server(const Settings& settings);
+		~Server();
+
+		Server(const Server&) = delete;
+		Server& operator=(const Server&) = delete;
+
+	public:
+		/// @brief Starts listening on @p path , replacing a socket file left over from a previous run.
+		bool Open(const char* path);
+
+		/// @brief Serves clients until Stop is called, then finishes all queued requests.
+		bool Run();
+
+		/// @brief Makes Run return, safe to call from a signal handler.
+		void Stop();
+
+	private:
+		void Close();
+
+		/// @brief Queues @p job unless the queue is full, never waits.
+		bool TryPush(Job&& job);
+		bool IsQueueFull();
+		void WorkerMain();
+	};
+}
@@ -0,0 +1,147 @@
+// Serves a JSON Lines file of requests to itself several times over one connection
+// and checks every request got exactly its results back.
+// Usage: NurikabeServerTest <requests> [copies]
+
+#include "NurikabeServer.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// the id as written in the request, results start with the same text
+static std::string GetId(const std::string& line)
+{
+	const std::string prefix = "{\"id\":";
+	if (line.compare(0, prefix.size(), prefix) != 0)
+		return std::string();
+
+	size_t end = line.find(',', prefix.size());
+	if (end == std::string::npos)
+		return std::string();
+
+	return line.substr(prefix.size(), end - prefix.size());
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: NurikabeServerTest <requests> [copies]" << '\n';
+		return 1;
+	}
+
+	int copies = 20;
+	if (argc > 2)
+		sscanf(argv[2], "%d", &copies);
+
+	std::string requests;
+	std::map<std::string, int> expected;
+	{
+		std::ifstream file(argv[1]);
+		std::string line;
+		while (std::getline(file, line))
+		{
+			if (line.empty())
+				continue;
+			requests += line + '\n';
+			expected[GetId(line)] += copies;
+		}
+	}
+
+	if (expected.empty())
+	{
+		std::cout << "No requests in '" << argv[1] << "'" << '\n';
+		return 1;
+	}
+
+	// a small queue, so the server has to stop reading from the client in between
+	Nurikabe::Server::Settings settings;
+	settings.workerCount = 2;
+	settings.queueCapacity = 1;
+
+	const char* path = "server-test.sock";
+	Nurikabe::Server server(settings);
+	if (!server.Open(path))
+	{
+		std::cout << "Failed to listen on '" << path << "'" << '\n';
+		return 1;
+	}
+
+	std::thread serverThread([&server]() { server.Run(); });
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	std::snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+	if (fd < 0 || connect(fd, (const sockaddr*)&address, sizeof(address)) != 0)
+	{
+		std::cout << "Failed to connect to '" << path << "'" << '\n';
+		server.Stop();
+		serverThread.join();
+		return 1;
+	}
+
+	// sends while results are read, as clients with many requests have to
+	std::thread sender([fd, &requests, copies]()
+	{
+		for (int i = 0; i < copies; i++)
+		{
+			size_t sent = 0;
+			while (sent < requests.size())
+			{
+				ssize_t count = send(fd, requests.data() + sent, requests.size() - sent, 0);
+				if (count <= 0)
+					return;
+				sent += count;
+			}
+		}
+		shutdown(fd, SHUT_WR);
+	});
+
+	std::map<std::string, int> received;
+	std::string input;
+	char buffer[4096];
+	ssize_t count;
+	while ((count = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+		input.append(buffer, count);
+
+	sender.join();
+	close(fd);
+	server.Stop();
+	serverThread.join();
+
+	size_t start = 0;
+	size_t end;
+	while ((end = input.find('\n', start)) != std::string::npos)
+	{
+		received[GetId(input.substr(start, end - start))]++;
+		start = end + 1;
+	}
+
+	int failCount = 0;
+	for (const auto& [id, count] : expected)
+	{
+		if (received[id] != count)
+		{
+			std::cout << "Request " << id << ": " << received[id] << " of " << count << " results" << '\n';
+			failCount++;
+		}
+	}
+
+	if (received.size() != expected.size())
+	{
+		std::cout << "Results for requests that were not sent" << '\n';
+		failCount++;
+	}
+
+	if (failCount == 0)
+		std::cout << "All " << expected.size() * copies << " results received" << '\n';
+
+	return failCount;
+}
\ No newline at end of file
@@ -0,0 +1,451 @@
+#include "NurikabeSolutionCache.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace Nurikabe;
+
+static const char cacheMagic[4] = { 'N', 'K', 'S', 'C' };
+static const uint8_t cacheVersion = 1;
+static const size_t cacheHeaderSize = 8;
+static const size_t entryHeaderSize = 8;
+
+static const char indexMagic[4] = { 'N', 'K', 'S', 'X' };
+static const uint8_t indexVersion = 1;
+static const size_t indexHeaderSize = 40;
+
+namespace
+{
+	// one of the 8 rotations and reflections, mirroring happens before transposing
+	struct Orientation
+	{
+		bool flipX;
+		bool flipY;
+		bool transpose;
+
+		static Orientation FromIndex(int index) { return { (index & 1) != 0, (index & 2) != 0, (index & 4) != 0 }; }
+
+		int GetWidth(const Board& board) const { return transpose ? board.GetHeight() : board.GetWidth(); }
+		int GetHeight(const Board& board) const { return transpose ? board.GetWidth() : board.GetHeight(); }
+
+		Point Apply(const Board& board, const Point& pt) const
+		{
+			Point ret = { flipX ? board.GetWidth() - 1 - pt.x : pt.x, flipY ? board.GetHeight() - 1 - pt.y : pt.y };
+			if (transpose)
+				std::swap(ret.x, ret.y);
+			return ret;
+		}
+	};
+
+	void AppendVarint(std::string& out, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back((char)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((char)value);
+	}
+
+	void AppendInteger(std::string& out, uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+			out.push_back((char)(value >> (8 * i)));
+	}
+
+	uint32_t ReadInteger(const char* data)
+	{
+		uint32_t value = 0;
+		for (int i = 0; i < 4; i++)
+			value |= (uint32_t)(uint8_t)data[i] << (8 * i);
+		return value;
+	}
+
+	void WriteInteger64(char* data, uint64_t value)
+	{
+		for (int i = 0; i < 8; i++)
+			data[i] = (char)(value >> (8 * i));
+	}
+
+	uint64_t ReadInteger64(const char* data)
+	{
+		uint64_t value = 0;
+		for (int i = 0; i < 8; i++)
+			value |= (uint64_t)(uint8_t)data[i] << (8 * i);
+		return value;
+	}
+
+	uint64_t HashKey(std::string_view key)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : key)
+		{
+			hash ^= (uint8_t)c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	std::string BuildKey(const Board& puzzle, const Orientation& orientation)
+	{
+		const int width = orientation.GetWidth(puzzle);
+
+		std::vector<std::pair<int, int>> clues;
+		for (int y = 0; y < puzzle.GetHeight(); y++)
+		{
+			for (int x = 0; x < puzzle.GetWidth(); x++)
+			{
+				int size = puzzle.GetRequiredSize({ x, y });
+				if (size == 0)
+					continue;
+
+				Point pt = orientation.Apply(puzzle, { x, y });
+				clues.push_back({ pt.y * width + pt.x, size });
+			}
+		}
+		std::sort(clues.begin(), clues.end());
+
+		std::string key;
+		AppendVarint(key, width);
+		AppendVarint(key, orientation.GetHeight(puzzle));
+
+		int previousIndex = 0;
+		for (const auto& clue : clues)
+		{
+			AppendVarint(key, clue.first - previousIndex);
+			AppendVarint(key, clue.second);
+			previousIndex = clue.first;
+		}
+		return key;
+	}
+
+	// smallest key over all orientations, together with the orientation giving it
+	std::string BuildCanonicalKey(const Board& puzzle, Orientation& orientation)
+	{
+		std::string best;
+		for (int i = 0; i < 8; i++)
+		{
+			auto candidate = Orientation::FromIndex(i);
+			auto key = BuildKey(puzzle, candidate);
+			if (i == 0 || key < best)
+			{
+				best = std::move(key);
+				orientation = candidate;
+			}
+		}
+		return best;
+	}
+}
+
+bool SolutionCache::Open(const char* path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	entries.clear();
+	addedEntries.clear();
+	builtIndex.clear();
+	slots = nullptr;
+	slotCount = 0;
+	indexedCount = 0;
+	indexFile.Close();
+	file.Close();
+	filename = path;
+
+	// new cache, it needs a header before anything is appended
+	{
+		std::ofstream stream(filename, std::ios::binary | std::ios::app);
+		if (!stream.is_open())
+			return false;
+
+		if (stream.tellp() == 0)
+		{
+			stream.write(cacheMagic, sizeof(cacheMagic));
+			stream.put((char)cacheVersion);
+			stream.put(0);
+			stream.put(0);
+			stream.put(0);
+		}
+
+		if (!stream)
+			return false;
+	}
+
+	if (!file.Open(path))
+		return false;
+
+	const char* data = file.GetData();
+	if (file.GetSize() < cacheHeaderSize || std::memcmp(data, cacheMagic, sizeof(cacheMagic)) != 0 || (uint8_t)data[4] != cacheVersion)
+		return false;
+
+	const std::string indexFilename = filename + ".idx";
+	size_t indexedSize = cacheHeaderSize;
+	if (!OpenIndex(indexFilename, indexedSize))
+		indexedSize = cacheHeaderSize;
+
+	ReadEntries(indexedSize);
+
+	// entries that are not indexed are read at every open, once there are many the index is built again
+	if (!entries.empty() && entries.size() * 8 >= (size_t)indexedCount)
+	{
+		entries.clear();
+		BuildIndex(indexFilename);
+	}
+
+	return true;
+}
+
+bool SolutionCache::OpenIndex(const std::string& indexFilename, size_t& indexedSize)
+{
+	if (!indexFile.Open(indexFilename.c_str()))
+		return false;
+
+	const char* data = indexFile.GetData();
+	const size_t size = indexFile.GetSize();
+
+	bool isValid = size >= indexHeaderSize && std::memcmp(data, indexMagic, sizeof(indexMagic)) == 0 && (uint8_t)data[4] == indexVersion;
+
+	const uint64_t coveredSize = isValid ? ReadInteger64(data + 8) : 0;
+	const uint64_t lastOffset = isValid ? ReadInteger64(data + 16) : 0;
+	const uint64_t count = isValid ? ReadInteger64(data + 24) : 0;
+	const uint64_t indexSlotCount = isValid ? ReadInteger64(data + 32) : 0;
+
+	// an index cut short by a writer that did not finish has fewer slots than it says
+	isValid = isValid
+		&& indexSlotCount > 0 && (indexSlotCount & (indexSlotCount - 1)) == 0
+		&& count < indexSlotCount && count <= INT32_MAX
+		&& (size - indexHeaderSize) / 8 == indexSlotCount && (size - indexHeaderSize) % 8 == 0
+		&& coveredSize >= cacheHeaderSize && coveredSize <= file.GetSize();
+
+	// The index belongs to this cache when its last entry ends where the index says. Slots
+	// are checked when they are used, a key that does not match is not found.
+	std::string_view key;
+	std::string_view solution;
+	if (isValid && count > 0)
+		isValid = ReadEntry(lastOffset, key, solution) && solution.data() + solution.size() == file.GetData() + coveredSize;
+	else if (isValid)
+		isValid = coveredSize == cacheHeaderSize;
+
+	if (!isValid)
+	{
+		indexFile.Close();
+		return false;
+	}
+
+	slots = data + indexHeaderSize;
+	slotCount = indexSlotCount;
+	indexedCount = (int)count;
+	indexedSize = coveredSize;
+	return true;
+}
+
+void SolutionCache::BuildIndex(const std::string& indexFilename)
+{
+	std::vector<size_t> offsets;
+	size_t offset = cacheHeaderSize;
+	size_t lastOffset = 0;
+	std::string_view key;
+	std::string_view solution;
+	while (ReadEntry(offset, key, solution))
+	{
+		offsets.push_back(offset);
+		lastOffset = offset;
+		offset += entryHeaderSize + key.size() + solution.size();
+	}
+
+	// at most half of the slots are used, so few keys share a slot
+	uint64_t newSlotCount = 16;
+	while (newSlotCount < 2 * offsets.size())
+		newSlotCount *= 2;
+
+	builtIndex.assign(indexHeaderSize + newSlotCount * 8, 0);
+	slots = builtIndex.data() + indexHeaderSize;
+	slotCount = newSlotCount;
+	indexedCount = 0;
+
+	for (size_t entryOffset : offsets)
+	{
+		ReadEntry(entryOffset, key, solution);
+
+		// a puzzle added by two processes at once is stored twice, the first one is found
+		std::string_view found;
+		if (FindSolution(key, found))
+			continue;
+
+		uint64_t slot = HashKey(key) & (slotCount - 1);
+		while (ReadInteger64(slots + slot * 8) != 0)
+			slot = (slot + 1) & (slotCount - 1);
+
+		WriteInteger64(builtIndex.data() + indexHeaderSize + slot * 8, entryOffset);
+		indexedCount++;
+	}
+
+	std::memcpy(builtIndex.data(), indexMagic, sizeof(indexMagic));
+	builtIndex[4] = (char)indexVersion;
+	WriteInteger64(builtIndex.data() + 8, offset);
+	WriteInteger64(builtIndex.data() + 16, lastOffset);
+	WriteInteger64(builtIndex.data() + 24, indexedCount);
+	WriteInteger64(builtIndex.data() + 32, slotCount);
+
+	// Written aside and renamed, so other processes open either the old index or the new
+	// one. An index that cannot be written is built again next time.
+	indexFile.Close();
+	const std::string writingFilename = indexFilename + ".tmp";
+	{
+		std::ofstream stream(writingFilename, std::ios::binary | std::ios::trunc);
+		stream.write(builtIndex.data(), builtIndex.size());
+		if (!stream.flush())
+			return;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(writingFilename, indexFilename, error);
+	if (error)
+		std::filesystem::remove(writingFilename, error);
+}
+
+void SolutionCache::ReadEntries(size_t offset)
+{
+	std::string_view key;
+	std::string_view solution;
+	while (ReadEntry(offset, key, solution))
+	{
+		std::string_view found;
+		if (!FindSolution(key, found))
+			entries.emplace(key, solution);
+
+		offset += entryHeaderSize + key.size() + solution.size();
+	}
+}
+
+bool SolutionCache::ReadEntry(size_t offset, std::string_view& key, std::string_view& solution) const
+{
+	const char* data = file.GetData();
+	const size_t size = file.GetSize();
+	if (offset < cacheHeaderSize || offset > size || size - offset < entryHeaderSize)
+		return false;
+
+	size_t keySize = ReadInteger(data + offset);
+	size_t solutionSize = ReadInteger(data + offset + 4);
+
+	// an entry cut short by a writer that did not finish, ignore it
+	if (size - offset - entryHeaderSize < keySize + solutionSize)
+		return false;
+
+	key = std::string_view(data + offset + entryHeaderSize, keySize);
+	solution = std::string_view(data + offset + entryHeaderSize + keySize, solutionSize);
+	return true;
+}
+
+bool SolutionCache::FindSolution(std::string_view key, std::string_view& solution) const
+{
+	auto it = entries.find(key);
+	if (it != entries.end())
+	{
+		solution = it->second;
+		return true;
+	}
+
+	if (slotCount == 0)
+		return false;
+
+	// an index file without empty slots is not looped over forever
+	std::string_view storedKey;
+	uint64_t slot = HashKey(key) & (slotCount - 1);
+	for (uint64_t i = 0; i < slotCount; i++, slot = (slot + 1) & (slotCount - 1))
+	{
+		uint64_t offset = ReadInteger64(slots + slot * 8);
+		if (offset == 0)
+			return false;
+
+		if (ReadEntry((size_t)offset, storedKey, solution) && storedKey == key)
+			return true;
+	}
+	return false;
+}
+
+int SolutionCache::GetCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return indexedCount + (int)entries.size();
+}
+
+bool SolutionCache::Find(const Board& puzzle, Board& solution) const
+{
+	Orientation orientation;
+	auto key = BuildCanonicalKey(puzzle, orientation);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::string_view mask;
+	if (!FindSolution(key, mask))
+		return false;
+
+	const int width = orientation.GetWidth(puzzle);
+	if (mask.size() != (size_t)(puzzle.GetWidth() * puzzle.GetHeight() + 7) / 8)
+		return false;
+
+	solution = puzzle;
+	for (int y = 0; y < puzzle.GetHeight(); y++)
+	{
+		for (int x = 0; x < puzzle.GetWidth(); x++)
+		{
+			Point pt = orientation.Apply(puzzle, { x, y });
+			int index = pt.y * width + pt.x;
+
+			if (mask[index / 8] & (1 << (index % 8)))
+				solution.SetBlack({ x, y });
+			else
+				solution.SetWhite({ x, y });
+		}
+	}
+	return true;
+}
+
+bool SolutionCache::Add(const Board& puzzle, const Board& solution)
+{
+	if (solution.GetWidth() != puzzle.GetWidth() || solution.GetHeight() != puzzle.GetHeight())
+		return false;
+
+	Orientation orientation;
+	auto key = BuildCanonicalKey(puzzle, orientation);
+
+	const int width = orientation.GetWidth(puzzle);
+	std::string mask((puzzle.GetWidth() * puzzle.GetHeight() + 7) / 8, 0);
+	for (int y = 0; y < puzzle.GetHeight(); y++)
+	{
+		for (int x = 0; x < puzzle.GetWidth(); x++)
+		{
+			if (!solution.IsBlack({ x, y }))
+				continue;
+
+			Point pt = orientation.Apply(puzzle, { x, y });
+			int index = pt.y * width + pt.x;
+			mask[index / 8] |= 1 << (index % 8);
+		}
+	}
+
+	std::string entry;
+	AppendInteger(entry, (uint32_t)key.size());
+	AppendInteger(entry, (uint32_t)mask.size());
+	entry += key;
+	entry += mask;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::string_view found;
+	if (filename.empty() || FindSolution(key, found))
+		return false;
+
+	// appended in one write, so entries of several processes do not interleave
+	std::ofstream stream(filename, std::ios::binary | std::ios::app);
+	stream.write(entry.data(), entry.size());
+	if (!stream.flush())
+		return false;
+
+	const auto& added = addedEntries.emplace_back(std::move(entry));
+	const char* data = added.data() + entryHeaderSize;
+	entries.emplace(std::string_view(data, key.size()), std::string_view(data + key.size(), mask.size()));
+	return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "NurikabeBoard.h"
+#include "NurikabeMappedFile.h"
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace Nurikabe
+{
+	// Solutions of already solved puzzles, stored on disk.
+	//
+	// Puzzles are identified by their clues only, so a rotated or mirrored copy
+	// of a puzzle finds the solution of the original. The key of a puzzle is the
+	// smallest encoding of its clues over all 8 rotations and reflections, and
+	// solutions are stored in the orientation of that key.
+	//
+	//   header   "NKSC", u8 version, 3 reserved bytes
+	//   entries  u32 key size, u32 solution size, key, solution, all integers little endian
+	//            key: varint width, varint height, clues as (varint index delta, varint size)
+	//            solution: 1 bit per square, set when black, first square in lowest bit
+	//
+	// The file is memory mapped when opened, so processes using the same cache
+	// share its pages. New solutions are appended with a single write each and
+	// are visible to other processes once they open the cache again.
+	//
+	// Entries are found through a hash table kept next to the cache in
+	// "<cache>.idx", also memory mapped, so opening does not read every entry.
+	//
+	//   header   "NKSX", u8 version, 3 reserved bytes, u64 size of the cache covered,
+	//            u64 offset of the last entry covered, u64 entry count, u64 slot count
+	//   slots    u64 offset of an entry in the cache, 0 for an empty slot. An entry is in
+	//            the slot of the FNV-1a hash of its key, or in one of the slots after it.
+	//
+	// Entries appended after the index was written are read at open. Once they
+	// are more than an eighth of the entries in the index, the index is built
+	// again and replaces the old one.
+	class SolutionCache
+	{
+		MappedFile file;
+		std::string filename;
+
+		// slots of the index, either mapped from the index file or built in memory
+		MappedFile indexFile;
+		std::string builtIndex;
+		const char* slots = nullptr;
+		uint64_t slotCount = 0;
+		int indexedCount = 0;
+
+		// key -> solution of entries the index does not cover, pointing into the mapping or into `addedEntries`
+		std::unordered_map<std::string_view, std::string_view> entries;
+		std::deque<std::string> addedEntries;
+
+		mutable std::mutex mutex;
+
+	public:
+		/// @brief Opens or creates the cache at @p path .
+		bool Open(const char* path);
+
+		int GetCount() const;
+
+		/// @brief Fills @p solution with the stored solution of @p puzzle , oriented like @p puzzle .
+		bool Find(const Board& puzzle, Board& solution) const;
+
+		/// @brief Stores @p solution of @p puzzle , in memory and in the file.
+		bool Add(const Board& puzzle, const Board& solution);
+
+	private:
+		/// @brief Maps the index at @p indexFilename when it covers the start of the cache, setting @p indexedSize to the size it covers.
+		bool OpenIndex(const std::string& indexFilename, size_t& indexedSize);
+		/// @brief Builds the index of every entry of the cache and writes it to @p indexFilename .
+		void BuildIndex(const std::string& indexFilename);
+		/// @brief Reads entries from @p offset to the end of the cache into `entries`.
+		void ReadEntries(size_t offset);
+
+		bool ReadEntry(size_t offset, std::string_view& key, std::string_view& solution) const;
+		bool FindSolution(std::string_view key, std::string_view& solution) const;
+	};
+}
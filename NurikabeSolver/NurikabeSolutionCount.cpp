@@ -0,0 +1,410 @@
+#include "NurikabeSolutionCount.h"
+#include <vector>
+
+using namespace Nurikabe;
+
+namespace
+{
+	enum State : int8_t
+	{
+		Unknown,
+		Black,
+		White,
+		// not part of the puzzle
+		Wall
+	};
+
+	class Counter
+	{
+	private:
+		SolutionCountSettings settings;
+		int width;
+		int height;
+		int squareCount;
+
+		std::vector<int8_t> start;
+		// size of the clue of every square, 0 for squares without one
+		std::vector<int> clues;
+
+		int solutionCount;
+		int nodeCount;
+		bool isAborted;
+
+		// island of every white square, -1 for others
+		std::vector<int> islands;
+		std::vector<int> islandSizes;
+		// 0 for islands without a clue
+		std::vector<int> islandClues;
+		std::vector<int> distances;
+		std::vector<bool> isReached;
+		std::vector<int> queue;
+
+	public:
+		Counter(const Board& puzzle, const SolutionCountSettings& settings)
+			: settings(settings)
+			, width(puzzle.GetWidth())
+			, height(puzzle.GetHeight())
+			, squareCount(puzzle.GetWidth() * puzzle.GetHeight())
+			, start(squareCount, Unknown)
+			, clues(squareCount, 0)
+			, solutionCount(0)
+			, nodeCount(0)
+			, isAborted(false)
+		{
+			for (int i = 0; i < squareCount; i++)
+			{
+				const Square& square = puzzle.Get({ i % width, i / width });
+				switch (square.GetState())
+				{
+				case SquareState::Black:
+					start[i] = Black;
+					break;
+				case SquareState::White:
+					start[i] = White;
+					if (square.GetSize() > 0)
+						clues[i] = square.GetSize();
+					break;
+				case SquareState::Wall:
+					start[i] = Wall;
+					break;
+				default:
+					break;
+				}
+			}
+		}
+
+		int Count()
+		{
+			std::vector<int8_t> state = start;
+			Search(state);
+			return isAborted ? -1 : solutionCount;
+		}
+
+	private:
+		template <typename Callback>
+		void ForEachNeighbour(int index, Callback callback) const
+		{
+			const int x = index % width;
+			const int y = index / width;
+			if (x > 0) callback(index - 1);
+			if (x < width - 1) callback(index + 1);
+			if (y > 0) callback(index - width);
+			if (y < height - 1) callback(index + width);
+		}
+
+		// Numbers the islands of @p state , false when an island has two clues or is larger than its clue.
+		bool FindIslands(const std::vector<int8_t>& state)
+		{
+			islands.assign(squareCount, -1);
+			islandSizes.clear();
+			islandClues.clear();
+
+			for (int i = 0; i < squareCount; i++)
+			{
+				if (state[i] != White || islands[i] >= 0)
+					continue;
+
+				const int island = (int)islandSizes.size();
+				int size = 0;
+				int clue = 0;
+
+				queue.clear();
+				queue.push_back(i);
+				islands[i] = island;
+				for (size_t next = 0; next < queue.size(); next++)
+				{
+					int current = queue[next];
+					size++;
+					if (clues[current] > 0)
+					{
+						if (clue > 0)
+							return false;
+						clue = clues[current];
+					}
+
+					ForEachNeighbour(current, [this, &state, island](int neighbour)
+					{
+						if (state[neighbour] == White && islands[neighbour] < 0)
+						{
+							islands[neighbour] = island;
+							queue.push_back(neighbour);
+						}
+					});
+				}
+
+				if (clue > 0 && size > clue)
+					return false;
+
+				islandSizes.push_back(size);
+				islandClues.push_back(clue);
+			}
+
+			return true;
+		}
+
+		// Decides squares that are the same in every solution, false when there is none.
+		bool Deduce(std::vector<int8_t>& state)
+		{
+			while (true)
+			{
+				if (!FindIslands(state))
+					return false;
+
+				// white here would join two clues or grow an island past its clue
+				bool hasChanged = false;
+				for (int i = 0; i < squareCount; i++)
+				{
+					if (state[i] != Unknown)
+						continue;
+
+					int joined[4];
+					int joinedCount = 0;
+					ForEachNeighbour(i, [this, &joined, &joinedCount](int neighbour)
+					{
+						int island = islands[neighbour];
+						if (island < 0)
+							return;
+						for (int j = 0; j < joinedCount; j++)
+						{
+							if (joined[j] == island)
+								return;
+						}
+						joined[joinedCount++] = island;
+					});
+
+					int size = 1;
+					int clueCount = 0;
+					int clue = 0;
+					for (int j = 0; j < joinedCount; j++)
+					{
+						size += islandSizes[joined[j]];
+						if (islandClues[joined[j]] > 0)
+						{
+							clueCount++;
+							clue = islandClues[joined[j]];
+						}
+					}
+
+					if (clueCount > 1 || (clueCount == 1 && size > clue))
+					{
+						state[i] = Black;
+						hasChanged = true;
+					}
+				}
+				if (hasChanged)
+					continue;
+
+				// three black squares of a 2x2 make the fourth white
+				for (int y = 0; y < height - 1; y++)
+				{
+					for (int x = 0; x < width - 1; x++)
+					{
+						const int pool[] = { y * width + x, y * width + x + 1, (y + 1) * width + x, (y + 1) * width + x + 1 };
+						int blackCount = 0;
+						int unknown = -1;
+						for (int i : pool)
+						{
+							if (state[i] == Black)
+								blackCount++;
+							else if (state[i] == Unknown)
+								unknown = i;
+						}
+
+						if (blackCount == 4)
+							return false;
+						if (blackCount == 3 && unknown >= 0)
+						{
+							state[unknown] = White;
+							hasChanged = true;
+						}
+					}
+				}
+				if (hasChanged)
+					continue;
+
+				if (!Reach(state, hasChanged))
+					return false;
+				if (hasChanged)
+					continue;
+
+				return IsWallConnectable(state);
+			}
+		}
+
+		// Makes squares no island can reach black, false when an island cannot grow to its clue
+		// or white squares cannot be reached.
+		bool Reach(std::vector<int8_t>& state, bool& hasChanged)
+		{
+			isReached.assign(squareCount, false);
+			distances.assign(squareCount, -1);
+
+			for (int island = 0; island < (int)islandSizes.size(); island++)
+			{
+				const int clue = islandClues[island];
+				if (clue == 0)
+					continue;
+
+				queue.clear();
+				for (int i = 0; i < squareCount; i++)
+				{
+					if (islands[i] == island)
+					{
+						distances[i] = 0;
+						queue.push_back(i);
+					}
+				}
+
+				// Squares the island can grow into, each step adds at least a square to it. The
+				// island cannot touch the square of another clue, so it cannot grow next to one.
+				const int missing = clue - islandSizes[island];
+				int reachable = 0;
+				for (size_t next = 0; next < queue.size(); next++)
+				{
+					int current = queue[next];
+					isReached[current] = true;
+					if (distances[current] >= missing)
+						continue;
+
+					ForEachNeighbour(current, [this, &state, &reachable, island, current](int neighbour)
+					{
+						if (distances[neighbour] >= 0 || (state[neighbour] != Unknown && state[neighbour] != White))
+							return;
+
+						bool isNextToClue = false;
+						ForEachNeighbour(neighbour, [this, island, &isNextToClue](int around)
+						{
+							int other = islands[around];
+							if (other >= 0 && other != island && islandClues[other] > 0)
+								isNextToClue = true;
+						});
+						if (isNextToClue)
+							return;
+
+						distances[neighbour] = distances[current] + 1;
+						queue.push_back(neighbour);
+						reachable++;
+					});
+				}
+
+				for (int i : queue)
+					distances[i] = -1;
+
+				if (reachable < missing)
+					return false;
+			}
+
+			for (int i = 0; i < squareCount; i++)
+			{
+				if (isReached[i])
+					continue;
+
+				if (state[i] == White)
+					return false;
+				if (state[i] == Unknown)
+				{
+					state[i] = Black;
+					hasChanged = true;
+				}
+			}
+
+			return true;
+		}
+
+		// The black squares have to be connected through squares that can still be black.
+		bool IsWallConnectable(const std::vector<int8_t>& state)
+		{
+			int blackCount = 0;
+			int first = -1;
+			for (int i = 0; i < squareCount; i++)
+			{
+				if (state[i] == Black)
+				{
+					blackCount++;
+					if (first < 0)
+						first = i;
+				}
+			}
+			if (blackCount == 0)
+				return true;
+
+			isReached.assign(squareCount, false);
+			queue.clear();
+			queue.push_back(first);
+			isReached[first] = true;
+			int reachedBlackCount = 0;
+			for (size_t next = 0; next < queue.size(); next++)
+			{
+				int current = queue[next];
+				if (state[current] == Black)
+					reachedBlackCount++;
+
+				ForEachNeighbour(current, [this, &state](int neighbour)
+				{
+					if (!isReached[neighbour] && (state[neighbour] == Black || state[neighbour] == Unknown))
+					{
+						isReached[neighbour] = true;
+						queue.push_back(neighbour);
+					}
+				});
+			}
+
+			return reachedBlackCount == blackCount;
+		}
+
+		void Search(std::vector<int8_t>& state)
+		{
+			if (isAborted || solutionCount >= settings.maxSolutions)
+				return;
+
+			if (++nodeCount > settings.maxNodes)
+			{
+				isAborted = true;
+				return;
+			}
+
+			if (!Deduce(state))
+				return;
+
+			// Guessing next to an island that is not complete yet decides most. Without unknown
+			// squares the board is a solution, every rule checked it.
+			int guess = -1;
+			for (int i = 0; i < squareCount; i++)
+			{
+				if (state[i] != Unknown)
+					continue;
+
+				bool isNextToIsland = false;
+				ForEachNeighbour(i, [this, &isNextToIsland](int neighbour)
+				{
+					int island = islands[neighbour];
+					if (island >= 0 && islandClues[island] > islandSizes[island])
+						isNextToIsland = true;
+				});
+
+				if (guess < 0 || isNextToIsland)
+					guess = i;
+				if (isNextToIsland)
+					break;
+			}
+
+			if (guess < 0)
+			{
+				solutionCount++;
+				return;
+			}
+
+			std::vector<int8_t> white = state;
+			white[guess] = White;
+			Search(white);
+
+			state[guess] = Black;
+			Search(state);
+		}
+	};
+}
+
+int Nurikabe::CountSolutions(const Board& puzzle, const SolutionCountSettings& settings)
+{
+	Counter counter(puzzle, settings);
+	return counter.Count();
+}
\ No newline at end of file
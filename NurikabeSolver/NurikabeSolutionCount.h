@@ -0,0 +1,24 @@
+#pragma once
+#include "NurikabeBoard.h"
+
+namespace Nurikabe
+{
+	// Counts the solutions of a puzzle with a search over every square.
+	//
+	// Solver stops at the first solution, and some of its rules pick a solution
+	// rather than deduce one, so solving cannot tell whether a puzzle has only
+	// one. This search decides squares only by what holds in every solution: no
+	// island with two clues or more squares than its clue, none out of reach of
+	// a clue, no 2x2 of black and a connected wall. Everything else is guessed
+	// both ways, which is slow on large boards, hence the limit on the search.
+	struct SolutionCountSettings
+	{
+		// counting stops once this many solutions are found
+		int maxSolutions = 2;
+		// guesses before the search gives up
+		int maxNodes = 100000;
+	};
+
+	/// @brief Counts the solutions of @p puzzle up to the maximum of @p settings , -1 when the search gave up.
+	int CountSolutions(const Board& puzzle, const SolutionCountSettings& settings = SolutionCountSettings());
+}
\ No newline at end of file
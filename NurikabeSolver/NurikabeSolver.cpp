@@ -1,7 +1,13 @@
 #include "NurikabeSolver.h"
+#include "NurikabeAllocations.h"
+#include "NurikabePerf.h"
+#include "NurikabeTrace.h"
 #include <iostream>
 #include <assert.h>
 #include <cmath>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
 
 using namespace Nurikabe;
 
@@ -11,13 +17,15 @@ Square Solver::GetInitialWhite(int initialWhiteIndex)
 	return board.Get(initialWhites[initialWhiteIndex]);
 }
 
-static int nextSolverID = 0;
+// solvers can be created on several threads at once, see NurikabeServer.h
+static std::atomic<int> nextSolverID = 0;
 
 Solver::Solver(const Board& initialBoard, int* iteration)
 	: board(initialBoard)
 	, iteration(iteration)
 	, depth(0)
 	, id(nextSolverID++)
+	, observer(nullptr)
 {
 	Initialize();
 }
@@ -28,23 +36,53 @@ Solver::Solver(const Solver& other)
 	, unsolvedWhites(other.unsolvedWhites)
 	, startOfUnconnectedWhite(other.startOfUnconnectedWhite)
 	, contiguousRegions(other.contiguousRegions)
+	, regionLabels(other.regionLabels)
+	, whiteParents(other.whiteParents)
+	, whiteSizes(other.whiteSizes)
+	, whiteOrigins(other.whiteOrigins)
+	, checkedSquares(other.checkedSquares)
+	, squareOwners(other.squareOwners)
+	, squareOwnerCounts(other.squareOwnerCounts)
+	, squareOwnersIteration(other.squareOwnersIteration)
+	, squareVersions(other.squareVersions)
+	, versionedSquares(other.versionedSquares)
+	, islandVersions(other.islandVersions)
+	, versionsIteration(other.versionsIteration)
+	, ruleCache(other.ruleCache)
 
 	//, solverStack(other.solverStack)
 	//, solutions(other.solutions)
 
 	, iteration(other.iteration)
 	, depth(other.depth)
-	, id(nextSolverID++)
+	, id(other.id)
+	, observer(other.observer)
 {
 }
 
 Solver& Solver::operator=(const Solver& other)
 {
+	PerfScope perfScope(PerfSection::SolverCopies);
+	TRACK_ALLOCATIONS(AllocationCategory::SolverCopy);
+
 	board = other.board;
 	initialWhites = other.initialWhites;
 	unsolvedWhites = other.unsolvedWhites;
 	startOfUnconnectedWhite = other.startOfUnconnectedWhite;
 	contiguousRegions = other.contiguousRegions;
+	regionLabels = other.regionLabels;
+	whiteParents = other.whiteParents;
+	whiteSizes = other.whiteSizes;
+	whiteOrigins = other.whiteOrigins;
+	checkedSquares = other.checkedSquares;
+	squareOwners = other.squareOwners;
+	squareOwnerCounts = other.squareOwnerCounts;
+	squareOwnersIteration = other.squareOwnersIteration;
+	squareVersions = other.squareVersions;
+	versionedSquares = other.versionedSquares;
+	islandVersions = other.islandVersions;
+	versionsIteration = other.versionsIteration;
+	ruleCache = other.ruleCache;
 
 	solverStack = other.solverStack;
 	solutions = other.solutions;
@@ -52,12 +90,33 @@ Solver& Solver::operator=(const Solver& other)
 	iteration = other.iteration;
 	depth = other.depth;
 	id = other.id;
+	observer = other.observer;
 
 	return *this;
 }
 
+Solver Solver::Copy() const
+{
+	PerfScope perfScope(PerfSection::SolverCopies);
+	TRACK_ALLOCATIONS(AllocationCategory::SolverCopy);
+
+	return Solver(*this);
+}
+
 void Solver::Initialize()
 {
+	int squareCount = board.GetWidth() * board.GetHeight();
+	whiteParents.assign(squareCount, -1);
+	whiteSizes.assign(squareCount, 0);
+	whiteOrigins.assign(squareCount, -1);
+	checkedSquares.assign(squareCount, Square());
+	squareOwners.clear();
+	squareOwnerCounts.clear();
+	squareOwnersIteration = -1;
+	squareVersions.assign(squareCount, 0);
+	versionedSquares.assign(squareCount, Square());
+	versionsIteration = -1;
+
 	board.ForEachSquare([this](const Point& pt, const Square& square)
 		{
 			if (square.GetSize() != 0)
@@ -72,26 +131,51 @@ void Solver::Initialize()
 
 			return true;
 		});
+
+	islandVersions.assign(initialWhites.size(), 0);
+	ruleCache.assign((int)CachedRule::Count * initialWhites.size(), -1);
+
+	// union-find starts out empty, so every square is new to it
+	board.MarkAllChanged();
 }
 
 void Solver::UpdateContiguousRegions()
 {
+	PerfScope perfScope(PerfSection::UpdateContiguousRegions);
+
 	// TODO: can be further optimized by updating only relevant regions instead of full rebuild
 	contiguousRegions.clear();
+	regionLabels.assign(board.GetWidth() * board.GetHeight(), -1);
 
-	Region handled(&board);
-
-	board.ForEachSquare([this, &handled](const Point& pt, const Square& sq)
+	board.ForEachSquare([this](const Point& pt, const Square& sq)
 	{
-		if (handled.Contains(pt))
+		if (regionLabels[pt.y * board.GetWidth() + pt.x] >= 0)
 			return true;
 
-		Region region = Region(&board, pt).ExpandAllInline(
-			[&sq](const Point&, const Square& sqInner) { return sqInner.GetState() == sq.GetState(); }
-		);
+		int label = (int)contiguousRegions.size();
+		regionLabels[pt.y * board.GetWidth() + pt.x] = label;
+
+		// breadth first, so squares are in the same order as with ExpandAllInline
+		std::vector<Point> squares;
+		squares.push_back(pt);
+		for (int i = 0; i < squares.size(); i++)
+		{
+			const Point neighbours[] = { squares[i].Left(), squares[i].Right(), squares[i].Up(), squares[i].Down() };
+			for (const auto& neighbour : neighbours)
+			{
+				if (!board.IsValidPosition(neighbour))
+					continue;
+
+				int& neighbourLabel = regionLabels[neighbour.y * board.GetWidth() + neighbour.x];
+				if (neighbourLabel >= 0 || board.Get(neighbour).GetState() != sq.GetState())
+					continue;
+
+				neighbourLabel = label;
+				squares.push_back(neighbour);
+			}
+		}
 
-		handled = Region::Union(handled, region);
-		contiguousRegions.push_back(region);
+		contiguousRegions.push_back(Region(&board, std::move(squares)));
 
 		return true;
 	});
@@ -183,9 +267,12 @@ bool Solver::SolveHighLevelRecursive(const SolveSettings& settings)
 			return false;
 
 		// Do a breadth search over all possible placements of black squares
-		Solver solver = Solver(*this);
+		Solver solver = Copy();
+		solver.id = nextSolverID++;
 		solver.depth++;
 		solver.board.SetBlack(pt);
+		NOTIFY_OBSERVER(*this, OnBranch(*this, solver, pt, SquareState::Black));
+		TraceSpan span("Probe black", solver.id, solver.depth);
 		
 		auto settingsNext = settings.Next();
 		settingsNext.maxDepth = 0;
@@ -198,6 +285,8 @@ bool Solver::SolveHighLevelRecursive(const SolveSettings& settings)
 
 			if (eval.IsSolved())
 			{
+				TRACK_ALLOCATIONS(AllocationCategory::SolverStack);
+				span.SetOutcome(TraceOutcome::Solved);
 				solvableFound = 1;
 				solverStack.clear();
 				solverStack.push_back(solver);
@@ -206,9 +295,12 @@ bool Solver::SolveHighLevelRecursive(const SolveSettings& settings)
 
 			isSolvable = eval.IsSolvable();
 		}
+		span.SetOutcome(isSolvable ? TraceOutcome::Solvable : TraceOutcome::Unsolvable);
 
 		if (solver.solverStack.size() > 0)
 		{
+			TRACK_ALLOCATIONS(AllocationCategory::SolverStack);
+
 			// solvers on stack are guaranteed to be solvable
 			solvableFound += solver.solverStack.size();
 			solverStack.insert(solverStack.end(), solver.solverStack.begin(), solver.solverStack.end());
@@ -217,9 +309,14 @@ bool Solver::SolveHighLevelRecursive(const SolveSettings& settings)
 
 		if (isSolvable)
 		{
+			TRACK_ALLOCATIONS(AllocationCategory::SolverStack);
 			solvableFound++;
 			solverStack.push_back(solver);
 		}
+		else
+		{
+			NOTIFY_OBSERVER(*this, OnBacktrack(solver));
+		}
 
 		// if (solvableFound > 0)
 		// {
@@ -339,19 +436,30 @@ bool Solver::SolveWhiteAtPredictableCorner(const SolveSettings& settings)
 				return true;
 
 			// this rule works most of the time, but not always
-			Solver solverCopy = Solver(*this);
+			Solver solverCopy = Copy();
+			solverCopy.id = nextSolverID++;
 			solverCopy.depth++;
 
 			Region((Board*)&solverCopy.GetBoard(), whiteNew.GetSquares()[0]).SetState(SquareState::White);
-			if (!solverCopy.CheckForSolvedWhites())
+			NOTIFY_OBSERVER(*this, OnBranch(*this, solverCopy, whiteNew.GetSquares()[0], SquareState::White));
+			TraceSpan span("Probe white", solverCopy.id, solverCopy.depth);
+			if (!solverCopy.CheckForSolvedWhitesOutsideRules())
+			{
+				span.SetOutcome(TraceOutcome::Unsolvable);
+				NOTIFY_OBSERVER(*this, OnBacktrack(solverCopy));
 				return true;
+			}
 
 			// because we are often confident that this path is the right one,
 			// we try to solve it completely so we either succeed or find out
 			// that this option was actually wrong.
 
-			if (solverCopy.Solve(SolveSettings()))
+			SolveSettings settingsCopy;
+			settingsCopy.deadline = settings.deadline;
+			settingsCopy.stopAtIteration = settings.stopAtIteration;
+			if (solverCopy.Solve(settingsCopy))
 			{
+				span.SetOutcome(TraceOutcome::Solved);
 				*this = solverCopy;
 				depth--;
 			}
@@ -359,6 +467,8 @@ bool Solver::SolveWhiteAtPredictableCorner(const SolveSettings& settings)
 			{
 				// because we proved that this board is not solvable,
 				// we can guarantee that `whiteNew` must be black.
+				span.SetOutcome(TraceOutcome::Unsolvable);
+				NOTIFY_OBSERVER(*this, OnBacktrack(solverCopy));
 
 				whiteNew.SetState(SquareState::Black);
 			}
@@ -375,95 +485,232 @@ Solver::Evaluation Solver::Evaluate()
 {
 	Evaluation eval;
 
-	eval.existsBlack2x2 = Rules::ContainsBlack2x2(board);
+	// per region summary, gathered in a single sweep over the board
+	struct RegionSummary
+	{
+		int squareCount = 0;
+		SquareValue origin = NoOrigin;
+		SquareValue size = 0;
+		bool hasOriginConflict = false;
+		bool hasSizeConflict = false;
+		bool isOpen = false;
+	};
+	std::vector<RegionSummary> summaries(contiguousRegions.size());
 
-	eval.progress = 0;
+	const int width = board.GetWidth();
+	const int height = board.GetHeight();
 
-	ForEachRegion([&eval](const Region& r)
+	for (int y = 0; y < height; y++)
 	{
-		if (r.GetState() == SquareState::Black)
+		for (int x = 0; x < width; x++)
 		{
-			if (eval.existsBlackRegion)
-				eval.existsMoreThanOneBlackRegion = true;
-			eval.existsBlackRegion = true;
+			Point pt = { x, y };
+			const auto& sq = board.Get(pt);
+			auto& summary = summaries[regionLabels[y * width + x]];
+
+			summary.squareCount++;
+
+			if (sq.GetState() == SquareState::Unknown)
+				continue;
+
+			if (sq.GetState() == SquareState::Black)
+			{
+				if (x > 0 && y > 0 &&
+					board.IsBlack(pt.Left()) &&
+					board.IsBlack(pt.Up()) &&
+					board.IsBlack(pt.Up().Left()))
+				{
+					eval.existsBlack2x2 = true;
+				}
+			}
+			else if (sq.GetState() == SquareState::White)
+			{
+				// same rules as Region::GetSameOrigin and Region::GetSameSize
+				if (sq.GetOrigin() != NoOrigin)
+				{
+					if (summary.origin == NoOrigin)
+						summary.origin = sq.GetOrigin();
+					else if (summary.origin != sq.GetOrigin())
+						summary.hasOriginConflict = true;
+				}
+				if (sq.GetSize() != 0)
+				{
+					if (summary.size == 0)
+						summary.size = sq.GetSize();
+					else if (summary.size != sq.GetSize())
+						summary.hasSizeConflict = true;
+				}
+			}
 
-			if (!eval.existsClosedBlack)
+			// black is closed when surrounded by white only and white when
+			// surrounded by black only. anything else opens the region.
+			if (!summary.isOpen)
 			{
-				bool isClosed = true;
-				r.Neighbours([&isClosed](const Point&, const Square& sq)
+				const Point neighbours[] = { pt.Left(), pt.Right(), pt.Up(), pt.Down() };
+				for (const auto& neighbour : neighbours)
 				{
-					if (sq.GetState() != SquareState::White)
+					if (!board.IsValidPosition(neighbour))
+						continue;
+
+					auto state = board.Get(neighbour).GetState();
+					if (state != SquareState::Black && state != SquareState::White)
 					{
-						isClosed = false;
-						return false;
+						summary.isOpen = true;
+						break;
 					}
-					return true;
-				});
-
-				if (isClosed)
-					eval.existsClosedBlack = true;
+				}
 			}
 		}
-		else if (r.GetState() == SquareState::White)
+	}
+
+	for (int i = 0; i < contiguousRegions.size(); i++)
+	{
+		const auto& summary = summaries[i];
+		auto state = contiguousRegions[i].GetState();
+
+		if (state == SquareState::Black)
 		{
-			if (r.GetSameOrigin() == (uint8_t)~0)
+			if (eval.existsBlackRegion)
+				eval.existsMoreThanOneBlackRegion = true;
+			eval.existsBlackRegion = true;
+
+			if (!summary.isOpen)
+				eval.existsClosedBlack = true;
+		}
+		else if (state == SquareState::White)
+		{
+			if (summary.origin == NoOrigin || summary.hasOriginConflict)
 			{
 				eval.existsUnconnectedWhite = true;
-				if (!eval.existsUnconnectedClosedWhite)
-				{
-					bool isClosed = true;
-					r.Neighbours([&isClosed](const Point&, const Square& sq)
-					{
-						if (sq.GetState() != SquareState::Black)
-						{
-							isClosed = false;
-							return false;
-						}
-						return true;
-					});
-
-					if (isClosed)
-						eval.existsUnconnectedClosedWhite = true;
-				}
+				if (!summary.isOpen)
+					eval.existsUnconnectedClosedWhite = true;
 			}
 			else
 			{
-				if (r.GetSquareCount() > r.GetSameSize())
-				{
+				int size = summary.hasSizeConflict ? 0 : summary.size;
+				if (summary.squareCount > size)
 					eval.existsTooLargeWhite = true;
-				}
+				else if (summary.squareCount < size && !summary.isOpen)
+					eval.existsTooSmallClosedWhite = true;
 			}
 		}
-		else if (r.GetState() == SquareState::Unknown)
+		else if (state == SquareState::Unknown)
 		{
-			eval.progress += r.GetSquareCount();
+			eval.progress += summary.squareCount;
 			eval.existsUnknownRegion = true;
 		}
-		return true;
-	});
+	}
 
-	eval.progress = 1 - (eval.progress / (board.GetWidth() * board.GetHeight()));
+	eval.progress = 1 - (eval.progress / (width * height));
 
 	return eval;
 }
 
+// Counters of the rules are kept per thread, so counting costs no more than
+// an increment, and added to the totals when the thread ends.
+static std::mutex phaseStatsMutex;
+static Solver::PhaseStats totalPhaseStats[Solver::PhaseCount];
+
+struct ThreadPhaseStats
+{
+	Solver::PhaseStats phases[Solver::PhaseCount];
+
+	~ThreadPhaseStats()
+	{
+		std::lock_guard<std::mutex> lock(phaseStatsMutex);
+		for (int i = 0; i < Solver::PhaseCount; i++)
+		{
+			totalPhaseStats[i].invocations += phases[i].invocations;
+			totalPhaseStats[i].nanoseconds += phases[i].nanoseconds;
+			totalPhaseStats[i].whites += phases[i].whites;
+			totalPhaseStats[i].blacks += phases[i].blacks;
+			totalPhaseStats[i].contradictions += phases[i].contradictions;
+			totalPhaseStats[i].progress += phases[i].progress;
+		}
+	}
+};
+
+static thread_local ThreadPhaseStats threadPhaseStats;
+
+std::vector<Solver::PhaseStats> Solver::GetPhaseStats()
+{
+	std::lock_guard<std::mutex> lock(phaseStatsMutex);
+
+	std::vector<PhaseStats> stats(totalPhaseStats, totalPhaseStats + PhaseCount);
+	for (int i = 0; i < PhaseCount; i++)
+	{
+		const auto& phase = threadPhaseStats.phases[i];
+		stats[i].invocations += phase.invocations;
+		stats[i].nanoseconds += phase.nanoseconds;
+		stats[i].whites += phase.whites;
+		stats[i].blacks += phase.blacks;
+		stats[i].contradictions += phase.contradictions;
+		stats[i].progress += phase.progress;
+	}
+	return stats;
+}
+
+const char* Solver::GetPhaseName(int phase)
+{
+	static const char* names[] =
+	{
+		"Patterns",
+		"InflateTrivial(White)",
+		"InflateTrivial(Black)",
+		"PerSquare",
+		"Unreachable",
+		"UnconnectedWhiteHasOnlyOnePossibleOrigin",
+		"IslandShapes",
+		"BalloonWhiteFillSpaceCompletely",
+		"DisjointedBlack",
+		"BlackInCorneredWhite2By3",
+		"BalloonWhiteSimple",
+		"WhiteAtPredictableCorner",
+		"HighLevelRecursive",
+	};
+	static_assert(sizeof(names) / sizeof(*names) == PhaseCount);
+
+	return phase >= 0 && phase < PhaseCount ? names[phase] : "";
+}
+
+void Solver::PrintPhaseStats(std::ostream& stream)
+{
+	char line[256];
+	std::snprintf(line, sizeof(line), "  %-2s %-40s %10s %10s %8s %8s %14s %8s\n",
+		"#", "rule", "calls", "ms", "whites", "blacks", "contradictions", "progress");
+	stream << "Rule statistics:" << '\n' << line;
+
+	auto stats = GetPhaseStats();
+	for (int i = 0; i < PhaseCount; i++)
+	{
+		std::snprintf(line, sizeof(line), "  %-2d %-40s %10llu %10.1f %8llu %8llu %14llu %8llu\n",
+			i, GetPhaseName(i), (unsigned long long)stats[i].invocations, stats[i].nanoseconds / 1e6,
+			(unsigned long long)stats[i].whites, (unsigned long long)stats[i].blacks,
+			(unsigned long long)stats[i].contradictions, (unsigned long long)stats[i].progress);
+		stream << line;
+	}
+}
+
 int Solver::SolvePhase(int phase, const SolveSettings& settings)
 {
 	std::function<bool()> phases[] =
 	{
+		[this](){ return SolvePatterns(); },
 		[this](){ return SolveInflateTrivial(SquareState::White); },
 		[this](){ return SolveInflateTrivial(SquareState::Black); },
 		[this](){ return SolvePerSquare(); },
 		[this](){ SolveUnreachable(); return true; },
+		[this](){ return SolveUnconnectedWhiteHasOnlyOnePossibleOrigin(); },
+		[this](){ return SolveIslandShapes(); },
 		[this](){ return SolveBalloonWhiteFillSpaceCompletely(); },
 		[this](){ SolveDisjointedBlack(); return true; },
 		[this](){ SolveBlackInCorneredWhite2By3(); return true; },
 		[this](){ return SolveBalloonWhiteSimple(); },
 		//[this](){ return SolveBalloonBlack(); },
-		//[this](){ return SolveUnconnectedWhiteHasOnlyOnePossibleOrigin(); },
 		[this, settings](){ return SolveWhiteAtPredictableCorner(settings); },
 		[this, settings](){ return SolveHighLevelRecursive(settings); },
 	};
+	static_assert(sizeof(phases) / sizeof(*phases) == PhaseCount);
 
 	if (phase >= sizeof(phases) / sizeof(*phases))
 		return -1;
@@ -484,8 +731,8 @@ bool Solver::SolveWithRules(const SolveSettings& settings)
 	const int checkFrequency = 10;
 	int iterationNextCheck = *iteration + checkFrequency;
 
-	const int printFrequency = 1000;
-	static int iterationNextPrint = *iteration;
+	// stopping at the iteration limit or the deadline has no outcome
+	TraceSpan span("SolveWithRules", id, depth);
 
 	UpdateContiguousRegions();
 
@@ -493,15 +740,58 @@ bool Solver::SolveWithRules(const SolveSettings& settings)
 	{
 		Board boardIterationStart = board;
 
-		int ret = SolvePhase(phase, settings);
+		NOTIFY_OBSERVER(*this, OnPhaseStart(*this, phase));
+
+		const bool isCountingStats = isCountingPhaseStats.load(std::memory_order_relaxed);
+		std::chrono::steady_clock::time_point phaseStart;
+		if (isCountingStats)
+			phaseStart = std::chrono::steady_clock::now();
+		TraceSpan phaseSpan(GetPhaseName(phase), id, depth);
+		int ret;
+		{
+			auto perfScope = PerfScope::Phase(phase);
+			ret = SolvePhase(phase, settings);
+		}
+		phaseSpan.Stop();
 
+		// every rule ran without finding anything
 		if (ret < 0)
+		{
+			phaseSpan.Cancel();
+			span.SetOutcome(TraceOutcome::Solvable);
 			break;
+		}
+
+		hasChangedInPrevLoop = (board != boardIterationStart);
+		phaseSpan.SetOutcome(ret == 0 ? TraceOutcome::Contradiction : hasChangedInPrevLoop ? TraceOutcome::Changed : TraceOutcome::Unchanged);
+
+		if (isCountingStats)
+		{
+			auto& stats = threadPhaseStats.phases[phase];
+			stats.invocations++;
+			stats.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - phaseStart).count();
+			if (ret == 0)
+				stats.contradictions++;
+			else if (hasChangedInPrevLoop)
+			{
+				stats.progress++;
+				CountCellsDecided(boardIterationStart, stats);
+			}
+		}
+
+		NOTIFY_OBSERVER(*this, OnPhaseEnd(*this, phase, hasChangedInPrevLoop, ret != 0));
 
 		if (ret == 0)
-		 	return false;
+		{
+			span.SetOutcome(TraceOutcome::Contradiction);
+			return false;
+		}
+
+#if NURIKABE_OBSERVERS
+		if (observer && hasChangedInPrevLoop)
+			NotifyCellsDecided(boardIterationStart, phase);
+#endif
 
-		hasChangedInPrevLoop = (board != boardIterationStart);
 		if (!hasChangedInPrevLoop)
 		{
 			phase++;
@@ -519,19 +809,20 @@ bool Solver::SolveWithRules(const SolveSettings& settings)
 
 			auto eval = Evaluate();
 			if (eval.IsSolved())
+			{
+				span.SetOutcome(TraceOutcome::Solved);
 				break;
+			}
 			if (!eval.IsSolvable())
+			{
+				span.SetOutcome(TraceOutcome::Contradiction);
 				return false;
+			}
 
-			if (GetIteration() >= iterationNextPrint)
-			{
-				std::cout << std::endl;
-				board.Print(std::cout);
-				std::cout << "Depth: " << depth << std::endl;
-				std::cout << "Iteration: " << *iteration << std::endl;
+			NOTIFY_OBSERVER(*this, OnProgress(*this));
 
-				iterationNextPrint = GetIteration() + printFrequency;
-			}
+			if (settings.IsPastDeadline())
+				return false;
 		}
 
 		if (settings.stopAtIteration >= 0 && *iteration >= settings.stopAtIteration)
@@ -541,24 +832,61 @@ bool Solver::SolveWithRules(const SolveSettings& settings)
 	return true;
 }
 
-void Solver::PrintBoardDiff(const Board& before)
+void Solver::CountCellsDecided(const Board& before, PhaseStats& stats) const
+{
+	for (int y = 0; y < board.GetHeight(); y++)
+	{
+		for (int x = 0; x < board.GetWidth(); x++)
+		{
+			Point pt = { x, y };
+			if (before.Get(pt).GetState() != SquareState::Unknown)
+				continue;
+
+			SquareState state = board.Get(pt).GetState();
+			if (state == SquareState::White)
+				stats.whites++;
+			else if (state == SquareState::Black)
+				stats.blacks++;
+		}
+	}
+}
+
+void Solver::NotifyCellsDecided(const Board& before, int phase)
 {
-	Board diff(before);
-	assert(Board::Difference(diff, board, false));
-	diff.ForEachSquare([](const Point&, const Square& sq)
+	for (int y = 0; y < board.GetHeight(); y++)
 	{
-		if (sq.GetState() == SquareState::Unknown)
-			((Square&)sq).SetState(SquareState::Black);
+		for (int x = 0; x < board.GetWidth(); x++)
+		{
+			Point pt = { x, y };
+			if (before.Get(pt).GetState() == SquareState::Unknown && board.Get(pt).GetState() != SquareState::Unknown)
+				observer->OnCellDecided(*this, pt, board.Get(pt).GetState(), phase);
+		}
+	}
+}
 
+bool Solver::CheckForSolvedWhitesOutsideRules()
+{
+#if NURIKABE_OBSERVERS
+	if (observer)
+	{
+		Board before = board;
+		if (!CheckForSolvedWhites())
+			return false;
+
+		NotifyCellsDecided(before, -1);
 		return true;
-	});
+	}
+#endif
+	return CheckForSolvedWhites();
+}
 
-	std::cout << std::endl;
-	const Board* boards[] = { &before, &diff, &board };
-	Board::Print(boards, 3, std::cout);
+bool Solver::SolveByDeduction()
+{
+	if (!CheckForSolvedWhitesOutsideRules())
+		return false;
 
-	std::cout << "Depth: " << depth << std::endl;
-	std::cout << "Iteration: " << *iteration << std::endl;
+	// rules that guess do nothing without depth
+	return SolveWithRules(SolveSettings::NoRecursion());
 }
 
 bool Solver::Solve(const SolveSettings& settings)
@@ -566,31 +894,44 @@ bool Solver::Solve(const SolveSettings& settings)
 	if (settings.maxDepth == 0)
 		return true;
 
-	if (!CheckForSolvedWhites())
+	if (!CheckForSolvedWhitesOutsideRules())
 		return false;
 
 	solverStack.clear();
-	solverStack.push_back(*this);
+	{
+		TRACK_ALLOCATIONS(AllocationCategory::SolverStack);
+		solverStack.push_back(*this);
+	}
 
 	while (true)
 	{
-		if (solverStack.size() == 0)
+		// nodes left on the stack would each run every rule once more before noticing the limit
+		if (solverStack.size() == 0 || settings.IsPastDeadline() || (settings.stopAtIteration >= 0 && *iteration >= settings.stopAtIteration))
 			return false;
 
 		int	solverIndex = solverStack.size() - 1;
 
-		Solver solver = solverStack[solverIndex];
+		Solver solver = solverStack[solverIndex].Copy();
 		solverStack.erase(solverStack.begin() + solverIndex);
 
+		TraceSpan span("Node", solver.id, solver.depth);
 		if (!solver.SolveWithRules(settings))
+		{
+			span.SetOutcome(TraceOutcome::Unsolvable);
+			NOTIFY_OBSERVER(*this, OnBacktrack(solver));
 			continue;
+		}
 
 		auto eval = solver.Evaluate();
 
 		if (eval.IsSolved())
 		{
+			span.SetOutcome(TraceOutcome::Solved);
 			board = solver.board;
+			// the union-find of this solver has not seen the squares of the solution
+			board.MarkAllChanged();
 			solverStack.clear();
+			NOTIFY_OBSERVER(*this, OnSolved(solver));
 			break;
 		}
 
@@ -601,8 +942,11 @@ bool Solver::Solve(const SolveSettings& settings)
 		// if (!eval.IsSolvable())
 		// 	continue;
 
+		// a node without guesses left is stuck
+		span.SetOutcome(solver.solverStack.empty() ? TraceOutcome::Unchanged : TraceOutcome::Branched);
 		for (int i = 0; i < solver.solverStack.size(); i++)
 		{
+			TRACK_ALLOCATIONS(AllocationCategory::SolverStack);
 			solverStack.push_back(solver.solverStack[i]);
 		}
 	}
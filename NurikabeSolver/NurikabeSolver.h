@@ -1,6 +1,10 @@
 #pragma once
 #include "NurikabeRules.h"
 #include "NurikabeBoard.h"
+#include "NurikabeObserver.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <vector>
 #include <stack>
 
@@ -23,18 +27,97 @@ namespace Nurikabe
 		std::vector<Point> startOfUnconnectedWhite;
 		std::vector<Region> contiguousRegions;
 
+		// index into `contiguousRegions` for every square of the board
+		std::vector<int> regionLabels;
+
+		// union-find over white squares, so islands and unconnected whites can
+		// be tracked without flooding them on every check. `checkedSquares` is
+		// the state of the board when union-find was last updated.
+		std::vector<int> whiteParents;
+		std::vector<int> whiteSizes;
+		std::vector<int> whiteOrigins;
+		std::vector<Square> checkedSquares;
+
+		// for every square, the first island that can still reach it and how many
+		// islands can (saturated at 2). Recomputed lazily once the board changes,
+		// `squareOwnersIteration` is the board iteration it was computed at.
+		std::vector<SquareValue> squareOwners;
+		std::vector<uint8_t> squareOwnerCounts;
+		int squareOwnersIteration;
+
+		// board iteration at which every square last changed, compared against
+		// `versionedSquares`. Version of an island is the latest change within the
+		// non-black area around it or its black border.
+		std::vector<int> squareVersions;
+		std::vector<Square> versionedSquares;
+		std::vector<int> islandVersions;
+		int versionsIteration;
+
+		// island version at which a rule last found nothing to do, for every rule and island
+		std::vector<int> ruleCache;
+
 		std::vector<Solver> solverStack;
 		std::vector<Solver> solutions;
 		int* iteration;
 		int depth;
+		// search node, copies keep it and every guess gets a new one
 		int id;
 
+		// not owned, shared with every solver branched from this one
+		Observer* observer;
+
+	public:
+		// rules whose results are remembered per island, see IsRuleCached
+		enum class CachedRule
+		{
+			BalloonWhiteSimple,
+			BlackInCorneredWhite2By3,
+			BalloonWhiteFillSpaceCompletely,
+			Count
+		};
+
+		static void PrintRuleCacheStats(std::ostream& stream);
+
+		// number of rules tried by SolvePhase
+		static constexpr int PhaseCount = 13;
+
+		// what a rule of SolvePhase did, summed over every solver of the search tree
+		struct PhaseStats
+		{
+			uint64_t invocations = 0;
+			// includes rules run by solvers the rule branched into
+			uint64_t nanoseconds = 0;
+			uint64_t whites = 0;
+			uint64_t blacks = 0;
+			uint64_t contradictions = 0;
+			// times the rule changed the board
+			uint64_t progress = 0;
+		};
+
+		// Rules are only timed and their squares only counted once this is set, both cost a clock
+		// read and a scan of the board every time a rule runs.
+		static inline std::atomic<bool> isCountingPhaseStats = false;
+
+		/// @brief Counters of every rule. Every thread counts on its own, threads that are still running only contribute when it is the calling thread.
+		static std::vector<PhaseStats> GetPhaseStats();
+		static void PrintPhaseStats(std::ostream& stream);
+
+		/// @brief Name of the rule run by SolvePhase for @p phase .
+		static const char* GetPhaseName(int phase);
+
 	public:
 		struct SolveSettings
 		{
 			int maxDepth = -1;
 			int stopAtIteration = -1;
 			bool stopAtFirstSolution = true;
+			// solving gives up once this time passes, checked every few iterations
+			std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+			bool IsPastDeadline() const
+			{
+				return deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= deadline;
+			}
 
 			SolveSettings Next() const
 			{
@@ -79,12 +162,13 @@ namespace Nurikabe
 			bool existsUnconnectedWhite = false;
 			bool existsUnconnectedClosedWhite = false;
 			bool existsTooLargeWhite = false;
+			bool existsTooSmallClosedWhite = false;
 			double progress = 0.0;
 			//bool existsWhiteTouchingAnother = false;
 
 			bool IsSolved() const
 			{
-				bool common = !existsUnknownRegion && !existsUnconnectedWhite && !existsTooLargeWhite && !existsUnconnectedClosedWhite && progress == 1.0;
+				bool common = !existsUnknownRegion && !existsUnconnectedWhite && !existsTooLargeWhite && !existsTooSmallClosedWhite && !existsUnconnectedClosedWhite && progress == 1.0;
 				
 				if (!existsBlackRegion)
 					return common;
@@ -99,7 +183,7 @@ namespace Nurikabe
 
 				return
 					!existsClosedBlack && !existsBlack2x2 &&
-					!existsTooLargeWhite && !existsUnconnectedClosedWhite;
+					!existsTooLargeWhite && !existsTooSmallClosedWhite && !existsUnconnectedClosedWhite;
 			}
 		};
 
@@ -112,6 +196,11 @@ namespace Nurikabe
 		Board& GetBoard() { return board; }
 
 		int GetIteration() const { return *iteration; }
+		int GetDepth() const { return depth; }
+		int GetId() const { return id; }
+
+		Observer* GetObserver() const { return observer; }
+		void SetObserver(Observer* newObserver) { observer = newObserver; }
 
 	public:
 		Solver(const Board& initialBoard, int* iteration);
@@ -122,12 +211,22 @@ namespace Nurikabe
 	private:
 		void Initialize();
 
+		/// @brief Copies the solver to guess on, counted as a solver copy by PerfCounters.
+		Solver Copy() const;
+
+	public:
+		/// @brief Rebuilds the contiguous regions of every state from scratch. Rules call this themselves, it is public for benchmarks.
 		void UpdateContiguousRegions();
-		
+
+	private:
+
 		void ForEachRegion(const RegionDelegate& callback);
 
 	private:
 
+		/// @brief Solves unknown squares from the 3x3 squares around them with one pass over the board, see NurikabePatterns.h.
+		bool SolvePatterns();
+
 		bool SolveInflateTrivial(SquareState state);
 
 		bool SolvePerSquare();
@@ -137,8 +236,11 @@ namespace Nurikabe
 		/// @brief Solves squares that cannot be reached by any white
 		void SolveUnreachable();
 
-		/// @brief Solves standalone islands by finding which squares are forced to white
-		bool SolveUnfinishedWhiteIsland();
+		/// @brief Solves standalone islands by finding which squares are forced to white. Only islands with root in @p changedRoots are checked.
+		bool SolveUnfinishedWhiteIsland(const std::vector<int>& changedRoots);
+
+		/// @brief Enumerates every possible completed shape of small islands. Squares contained in all shapes are white and squares bordering all shapes are black.
+		bool SolveIslandShapes();
 
 		bool SolveBalloonWhiteSimple();
 		int SolveBalloonWhiteSimple(const Region& r);
@@ -151,6 +253,7 @@ namespace Nurikabe
 		bool SolveUnconnectedWhiteHasOnlyOnePossibleOrigin();
 
 		void SolveBlackInCorneredWhite2By3();
+		bool SolveBlackInCorneredWhite2By3(const Region& r);
 
 		void SolveDisjointedBlack();
 
@@ -158,8 +261,27 @@ namespace Nurikabe
 		bool SolveGuessBlackToUnblock(int minSize);
 
 	private:
-		/// @brief Removes any solved white that is still in @p unsolvedWhites .
+		int FindWhite(int index);
+		bool UniteWhites(int a, int b);
+
+		/// @brief Adds squares changed since last call to union-find. Roots of sets that gained squares or black neighbours are appended to @p changedRoots .
+		bool UpdateWhiteSets(std::vector<int>& changedRoots);
+
+		/// @brief Removes any solved white that is still in @p unsolvedWhites . Only islands that changed since last call are checked.
 		bool CheckForSolvedWhites();
+		/// @brief CheckForSolvedWhites outside of the rules, squares around completed islands are reported to the observer with no rule.
+		bool CheckForSolvedWhitesOutsideRules();
+
+		bool IsTouchingAnotherIsland(const Point& pt, SquareValue origin) const;
+
+		/// @brief Finds which islands can reach each square, walking through unknown squares and unconnected whites within the number of squares the island is missing.
+		void UpdateSquareOwners();
+
+		void UpdateIslandVersions();
+
+		/// @brief Returns true when @p rule found nothing for island @p origin and nothing around the island changed since.
+		bool IsRuleCached(CachedRule rule, SquareValue origin);
+		void CacheRule(CachedRule rule, SquareValue origin);
 
 	private:
 
@@ -169,10 +291,15 @@ namespace Nurikabe
 		int SolvePhase(int phase, const SolveSettings& settings);
 		bool SolveWithRules(const SolveSettings& settings);
 
-		void PrintBoardDiff(const Board& before);
+		void CountCellsDecided(const Board& before, PhaseStats& stats) const;
+		void NotifyCellsDecided(const Board& before, int phase);
 
 	public:
-		bool Solve(const SolveSettings& settings = SolveSettings{-1, -1, true});
+		bool Solve(const SolveSettings& settings);
+		bool Solve() { return Solve(SolveSettings()); }
+
+		/// @brief Applies rules until none of them finds anything, without ever guessing. Returns false on a contradiction, the board can still be unfinished otherwise.
+		bool SolveByDeduction();
 		
 	};
 }
\ No newline at end of file
@@ -1,10 +1,47 @@
 #include "NurikabeSolver.h"
+#include "NurikabePatterns.h"
 #include <iostream>
 #include <assert.h>
 #include <cmath>
+#include <bitset>
+#include <memory>
+#include <atomic>
 
 using namespace Nurikabe;
 
+bool Solver::SolvePatterns()
+{
+	bool hasWhite = false;
+	for (int y = 0; y < board.GetHeight(); y++)
+	{
+		for (int x = 0; x < board.GetWidth(); x++)
+		{
+			Point pt = { x, y };
+			if (board.Get(pt).GetState() != SquareState::Unknown)
+				continue;
+
+			// squares decided earlier in the pass count for the ones after them
+			switch (Patterns::Deduce(board, pt))
+			{
+			case Patterns::Outcome::White:
+				board.SetWhite(pt);
+				startOfUnconnectedWhite.push_back(pt);
+				hasWhite = true;
+				break;
+			case Patterns::Outcome::Black:
+				board.SetBlack(pt);
+				break;
+			case Patterns::Outcome::Contradiction:
+				return false;
+			default:
+				break;
+			}
+		}
+	}
+
+	return !hasWhite || CheckForSolvedWhites();
+}
+
 bool Solver::SolveInflateTrivial(SquareState state)
 {
 
@@ -42,9 +79,10 @@ bool Solver::SolveInflateTrivial(SquareState state)
 			// if only 1 white is missing
 			Region diagonalBlack = Region(&GetBoard());
 			bool wasAssigned = false;
-			rContinuations.ForEachContiguousRegion([&diagonalBlack, &wasAssigned](const Region& r)
+			// the last white can be any single continuation, so only squares next to all of them are black
+			rContinuations.ForEach([this, &diagonalBlack, &wasAssigned](const Point& pt, const Square&)
 			{
-				auto expanded = Region(r).ExpandSingleInline();
+				auto expanded = Region(&board, pt).ExpandSingleInline();
 				if (diagonalBlack.GetSquareCount() == 0)
 				{
 					if (wasAssigned)
@@ -79,55 +117,48 @@ bool Solver::SolveInflateTrivial(SquareState state)
 
 bool Solver::SolvePerSquare()
 {
+	UpdateSquareOwners();
+
 	bool ret = true;
 	board.ForEachSquare([this, &ret](const Point& pt, const Square& square)
 	{
 		if (square.GetState() == SquareState::Unknown)
 		{
-			Region whiteNeighbours = Region(&board, pt)
-				.Neighbours([](const Point& pt, const Square& square) {
-					return square.GetState() == SquareState::White;
-				});
+			int index = pt.y * board.GetWidth() + pt.x;
 
+			// also covers squares touching two different islands
+			bool isReachable = squareOwnerCounts[index] != 0;
 
-			bool isSameOrigin = true;
-			uint8_t firstOrigin = (uint8_t)~0;
-			uint8_t firstSize = 0;
-			uint8_t longestUnconnectedWhite = 0;
-			whiteNeighbours.ForEachContiguousRegion([&isSameOrigin, &firstOrigin, &firstSize, &longestUnconnectedWhite](const Region& r)
+			if (isReachable)
 			{
-				if (r.GetSameOrigin() == (uint8_t)~0)
+				// the island together with unconnected whites around must not be too large
+				SquareValue origin = NoOrigin;
+				int whiteRoots[4];
+				int whiteRootCount = 0;
+				int whiteCount = 1;
+
+				const Point neighbours[] = { pt.Left(), pt.Right(), pt.Up(), pt.Down() };
+				for (const auto& neighbour : neighbours)
 				{
-					auto len = Region(r).ExpandAllInline([&longestUnconnectedWhite](const Point&, const Square& sq){
-						return sq.GetState() == SquareState::White;
-					}).GetSquareCount();
+					if (!board.IsWhite(neighbour))
+						continue;
 
-					if (len > longestUnconnectedWhite)
-						longestUnconnectedWhite = len;
-				}
-				else
-				{
-					if (firstOrigin == (uint8_t)~0)
-					{
-						firstOrigin = r.GetSameOrigin();
-						firstSize = r.GetSameSize();
-					}
-					else if (firstOrigin != r.GetSameOrigin())
-					{
-						isSameOrigin = false;
-						return false;
-					}
-				}
+					int root = whiteParents[neighbour.y * board.GetWidth() + neighbour.x] < 0 ? -1 : FindWhite(neighbour.y * board.GetWidth() + neighbour.x);
+					if (root < 0 || std::find(whiteRoots, whiteRoots + whiteRootCount, root) != whiteRoots + whiteRootCount)
+						continue;
 
-				return true;
-			});
+					whiteRoots[whiteRootCount++] = root;
+					whiteCount += whiteSizes[root];
 
-			if (isSameOrigin && firstOrigin != (uint8_t)~0 && longestUnconnectedWhite > firstSize)
-			{
-				isSameOrigin = false;
+					if (board.Get(neighbour).GetOrigin() != NoOrigin)
+						origin = board.Get(neighbour).GetOrigin();
+				}
+
+				if (origin != NoOrigin && whiteCount > board.GetRequiredSize(initialWhites[origin]))
+					isReachable = false;
 			}
 
-			if (!isSameOrigin)
+			if (!isReachable)
 			{
 				board.SetBlack(pt);
 				return RETURN_AFTER_FILLING_BLACK;
@@ -190,11 +221,175 @@ bool Solver::SolvePerSquare()
 	return ret;
 }
 
+int Solver::FindWhite(int index)
+{
+	while (whiteParents[index] != index)
+	{
+		whiteParents[index] = whiteParents[whiteParents[index]];
+		index = whiteParents[index];
+	}
+	return index;
+}
+
+bool Solver::UniteWhites(int a, int b)
+{
+	a = FindWhite(a);
+	b = FindWhite(b);
+	if (a == b)
+		return true;
+
+	// two different islands are touching
+	if (whiteOrigins[a] >= 0 && whiteOrigins[b] >= 0 && whiteOrigins[a] != whiteOrigins[b])
+		return false;
+
+	if (whiteSizes[a] < whiteSizes[b])
+		std::swap(a, b);
+
+	whiteParents[b] = a;
+	whiteSizes[a] += whiteSizes[b];
+	if (whiteOrigins[a] < 0)
+		whiteOrigins[a] = whiteOrigins[b];
+
+	return true;
+}
+
+bool Solver::UpdateWhiteSets(std::vector<int>& changedRoots)
+{
+	const int width = board.GetWidth();
+
+	// only squares set since the last update can differ from `checkedSquares`, those
+	// set back to what they were or listed twice are dropped from the list
+	std::vector<int> changed;
+	board.TakeChangedSquares(changed);
+
+	// every listed square is taken into account even after a contradiction, the board
+	// does not list them again
+	bool isValid = true;
+	size_t changedCount = 0;
+	for (int i : changed)
+	{
+		const auto& sq = board.Get({ i % width, i / width });
+		if (sq == checkedSquares[i])
+			continue;
+
+		bool wasWhite = checkedSquares[i].GetState() == SquareState::White;
+		checkedSquares[i] = sq;
+		changed[changedCount++] = i;
+
+		if (sq.GetState() != SquareState::White)
+			continue;
+
+		if (!wasWhite)
+		{
+			whiteParents[i] = i;
+			whiteSizes[i] = 1;
+			whiteOrigins[i] = -1;
+		}
+
+		if (sq.GetOrigin() != NoOrigin)
+		{
+			int root = FindWhite(i);
+			if (whiteOrigins[root] < 0)
+				whiteOrigins[root] = sq.GetOrigin();
+			else if (whiteOrigins[root] != sq.GetOrigin())
+				isValid = false;
+		}
+	}
+	changed.resize(changedCount);
+
+	if (!isValid)
+		return false;
+
+	// connect only after all new whites were added, so neighbours are known
+	for (int index : changed)
+	{
+		if (checkedSquares[index].GetState() != SquareState::White)
+			continue;
+
+		Point pt = { index % width, index / width };
+		const Point neighbours[] = { pt.Left(), pt.Right(), pt.Up(), pt.Down() };
+		for (const auto& neighbour : neighbours)
+		{
+			if (!board.IsWhite(neighbour))
+				continue;
+
+			if (!UniteWhites(index, neighbour.y * width + neighbour.x))
+				return false;
+		}
+	}
+
+	auto AddRoot = [this, &changedRoots](int index)
+	{
+		int root = FindWhite(index);
+		if (std::find(changedRoots.begin(), changedRoots.end(), root) == changedRoots.end())
+			changedRoots.push_back(root);
+	};
+
+	for (int index : changed)
+	{
+		if (checkedSquares[index].GetState() == SquareState::White)
+		{
+			AddRoot(index);
+			continue;
+		}
+
+		// whites next to a new black might have been closed off
+		Point pt = { index % width, index / width };
+		const Point neighbours[] = { pt.Left(), pt.Right(), pt.Up(), pt.Down() };
+		for (const auto& neighbour : neighbours)
+		{
+			if (board.IsWhite(neighbour) && whiteParents[neighbour.y * width + neighbour.x] >= 0)
+				AddRoot(neighbour.y * width + neighbour.x);
+		}
+	}
+
+	return true;
+}
+
 bool Solver::CheckForSolvedWhites()
 {
+	std::vector<int> changedRoots;
+	if (!UpdateWhiteSets(changedRoots))
+		return false;
+
+	const int width = board.GetWidth();
+
+	// unconnected whites which already know their island, spread it to squares joining them
+	for (int i = 0; i < changedRoots.size(); i++)
+	{
+		int root = changedRoots[i];
+		if (whiteOrigins[root] < 0)
+			continue;
+
+		Point pt = initialWhites[whiteOrigins[root]];
+		if (FindWhite(pt.y * width + pt.x) == root)
+			continue;
+
+		auto region = Region(&board, Point{ root % width, root / width })
+			.ExpandAllInline([](const Point& pt, const Square& square)
+				{
+					return square.GetState() == SquareState::White;
+				});
+		region.FixWhites();
+
+		region.ForEach([this, width](const Point& pt, const Square& sq)
+		{
+			checkedSquares[pt.y * width + pt.x] = sq;
+			return true;
+		});
+	}
+
 	for (int i = 0; i < unsolvedWhites.size(); i++)
 	{
 		Point pt = initialWhites[unsolvedWhites[i]];
+		int root = FindWhite(pt.y * width + pt.x);
+
+		if (std::find(changedRoots.begin(), changedRoots.end(), root) == changedRoots.end())
+			continue;
+
+		if (whiteSizes[root] > board.GetRequiredSize(pt))
+			return false;
+
 		auto region = Region(&board, pt)
 			.ExpandAllInline([](const Point& pt, const Square& square)
 				{
@@ -202,6 +397,13 @@ bool Solver::CheckForSolvedWhites()
 				});
 		region.FixWhites();
 
+		// squares which just received their origin are not a change worth checking again
+		region.ForEach([this, width](const Point& pt, const Square& sq)
+		{
+			checkedSquares[pt.y * width + pt.x] = sq;
+			return true;
+		});
+
 		if (region.GetSquareCount() == board.GetRequiredSize(pt))
 		{
 			// if region is of correct size, mark it as complete
@@ -213,10 +415,6 @@ bool Solver::CheckForSolvedWhites()
 			i--;
 			continue;
 		}
-		if (region.GetSquareCount() > board.GetRequiredSize(pt))
-		{
-			return false;
-		}
 		if (region.GetSquareCount() < board.GetRequiredSize(pt))
 		{
 			bool hasNonBlackNeighbour = false;
@@ -235,67 +433,257 @@ bool Solver::CheckForSolvedWhites()
 		}
 	}
 
+	// forget unconnected whites which were connected to an island or to each other
+	std::vector<int> unconnectedRoots;
 	for (int i = 0; i < startOfUnconnectedWhite.size(); i++)
 	{
-		Point pt = startOfUnconnectedWhite[i];
-		Region r = Region(&board, pt).ExpandAllInline([](const Point& pt, const Square& square)
+		const auto& pt = startOfUnconnectedWhite[i];
+		if (whiteParents[pt.y * width + pt.x] < 0)
+			continue;
+
+		int root = FindWhite(pt.y * width + pt.x);
+		if (whiteOrigins[root] >= 0 || std::find(unconnectedRoots.begin(), unconnectedRoots.end(), root) != unconnectedRoots.end())
 		{
-			return square.GetState() == SquareState::White && square.GetOrigin() == (uint8_t)~0;
-		});
+			startOfUnconnectedWhite.erase(startOfUnconnectedWhite.begin() + i);
+			i--;
+			continue;
+		}
+
+		unconnectedRoots.push_back(root);
+	}
+
+	SolveUnfinishedWhiteIsland(changedRoots);
+	return true;
+}
+
+bool Solver::IsTouchingAnotherIsland(const Point& pt, SquareValue origin) const
+{
+	const Point neighbours[] = { pt.Left(), pt.Right(), pt.Up(), pt.Down() };
+	for (const auto& neighbour : neighbours)
+	{
+		if (!board.IsWhite(neighbour))
+			continue;
+
+		auto neighbourOrigin = board.Get(neighbour).GetOrigin();
+		if (neighbourOrigin != NoOrigin && neighbourOrigin != origin)
+			return true;
+	}
+	return false;
+}
+
+void Solver::UpdateSquareOwners()
+{
+	if (squareOwnersIteration == board.GetIteration())
+		return;
+
+	const int width = board.GetWidth();
+	const int squareCount = width * board.GetHeight();
+
+	squareOwners.assign(squareCount, NoOrigin);
+	squareOwnerCounts.assign(squareCount, 0);
+	squareOwnersIteration = board.GetIteration();
+
+	auto AddOwner = [this](int index, SquareValue origin)
+	{
+		if (squareOwners[index] == origin)
+			return;
+
+		if (squareOwnerCounts[index] == 0)
+			squareOwners[index] = origin;
+
+		if (squareOwnerCounts[index] < 2)
+			squareOwnerCounts[index]++;
+	};
+
+	// squares of islands belong to them, solved or not
+	board.ForEachSquare([width, &AddOwner](const Point& pt, const Square& sq)
+	{
+		if (sq.GetState() == SquareState::White && sq.GetOrigin() != NoOrigin)
+			AddOwner(pt.y * width + pt.x, sq.GetOrigin());
+		return true;
+	});
+
+	std::vector<int> distances(squareCount, -1);
+	std::vector<Point> queue;
+
+	for (int i = 0; i < unsolvedWhites.size(); i++)
+	{
+		SquareValue origin = (SquareValue)unsolvedWhites[i];
+		Point start = initialWhites[origin];
+
+		// everything white connected to the island is already a part of it
+		queue.clear();
+		queue.push_back(start);
+		distances[start.y * width + start.x] = 0;
+		for (int q = 0; q < queue.size(); q++)
+		{
+			const Point neighbours[] = { queue[q].Left(), queue[q].Right(), queue[q].Up(), queue[q].Down() };
+			for (const auto& neighbour : neighbours)
+			{
+				if (!board.IsWhite(neighbour) || distances[neighbour.y * width + neighbour.x] >= 0)
+					continue;
+
+				distances[neighbour.y * width + neighbour.x] = 0;
+				queue.push_back(neighbour);
+				AddOwner(neighbour.y * width + neighbour.x, origin);
+			}
+		}
+
+		int missing = board.GetRequiredSize(start) - (int)queue.size();
 
-		for (int j = 0; j < startOfUnconnectedWhite.size(); j++)
+		for (int q = 0; q < queue.size(); q++)
 		{
-			if (j == i)
+			int distance = distances[queue[q].y * width + queue[q].x];
+			if (distance >= missing)
 				continue;
 
-			if (r.Contains(startOfUnconnectedWhite[j]))
+			const Point neighbours[] = { queue[q].Left(), queue[q].Right(), queue[q].Up(), queue[q].Down() };
+			for (const auto& neighbour : neighbours)
 			{
-				startOfUnconnectedWhite.erase(startOfUnconnectedWhite.begin() + j);
+				if (!board.IsValidPosition(neighbour) || distances[neighbour.y * width + neighbour.x] >= 0)
+					continue;
 
-				if (j < i)
-					i--; // TODO: untested condition
+				const auto& sq = board.Get(neighbour);
+				bool isFree =
+					sq.GetState() == SquareState::Unknown ||
+					(sq.GetState() == SquareState::White && (sq.GetOrigin() == NoOrigin || sq.GetOrigin() == origin));
 
-				j--;
+				if (!isFree || IsTouchingAnotherIsland(neighbour, origin))
+					continue;
+
+				distances[neighbour.y * width + neighbour.x] = distance + 1;
+				queue.push_back(neighbour);
+				AddOwner(neighbour.y * width + neighbour.x, origin);
 			}
 		}
 
-		if (board.Get(pt).GetOrigin() != (uint8_t)~0)
-		{
-			startOfUnconnectedWhite.erase(startOfUnconnectedWhite.begin() + i);
-			i--;
+		for (const auto& pt : queue)
+			distances[pt.y * width + pt.x] = -1;
+	}
+}
+
+// shared by solvers on all threads, exact ordering does not matter for statistics
+static std::atomic<int> ruleCacheHits[(int)Solver::CachedRule::Count];
+static std::atomic<int> ruleCacheMisses[(int)Solver::CachedRule::Count];
+
+void Solver::UpdateIslandVersions()
+{
+	if (versionsIteration == board.GetIteration())
+		return;
+
+	versionsIteration = board.GetIteration();
+
+	const int width = board.GetWidth();
+	const int squareCount = width * board.GetHeight();
+
+	for (int i = 0; i < squareCount; i++)
+	{
+		const auto& sq = board.Get({ i % width, i / width });
+		if (sq == versionedSquares[i])
 			continue;
+
+		versionedSquares[i] = sq;
+		squareVersions[i] = versionsIteration;
+	}
+
+	// islands sharing the same non-black area share the version
+	std::vector<int> labels(squareCount, -1);
+	std::vector<int> labelVersions;
+	std::vector<Point> queue;
+
+	for (int i = 0; i < unsolvedWhites.size(); i++)
+	{
+		Point start = initialWhites[unsolvedWhites[i]];
+		int& startLabel = labels[start.y * width + start.x];
+
+		if (startLabel < 0)
+		{
+			int label = (int)labelVersions.size();
+			int version = 0;
+
+			startLabel = label;
+			queue.clear();
+			queue.push_back(start);
+
+			for (int q = 0; q < queue.size(); q++)
+			{
+				version = std::max(version, squareVersions[queue[q].y * width + queue[q].x]);
+
+				const Point neighbours[] = { queue[q].Left(), queue[q].Right(), queue[q].Up(), queue[q].Down() };
+				for (const auto& neighbour : neighbours)
+				{
+					if (!board.IsValidPosition(neighbour))
+						continue;
+
+					int index = neighbour.y * width + neighbour.x;
+					if (board.IsBlack(neighbour))
+					{
+						version = std::max(version, squareVersions[index]);
+						continue;
+					}
+
+					if (labels[index] >= 0)
+						continue;
+
+					labels[index] = label;
+					queue.push_back(neighbour);
+				}
+			}
+
+			labelVersions.push_back(version);
 		}
+
+		islandVersions[unsolvedWhites[i]] = labelVersions[startLabel];
 	}
+}
 
-	SolveUnfinishedWhiteIsland();
-	return true;
+bool Solver::IsRuleCached(CachedRule rule, SquareValue origin)
+{
+	UpdateIslandVersions();
+
+	if (ruleCache[(int)rule * initialWhites.size() + origin] == islandVersions[origin])
+	{
+		ruleCacheHits[(int)rule].fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	ruleCacheMisses[(int)rule].fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+void Solver::CacheRule(CachedRule rule, SquareValue origin)
+{
+	UpdateIslandVersions();
+
+	ruleCache[(int)rule * initialWhites.size() + origin] = islandVersions[origin];
+}
+
+void Solver::PrintRuleCacheStats(std::ostream& stream)
+{
+	const char* names[] = { "BalloonWhiteSimple", "BlackInCorneredWhite2By3", "BalloonWhiteFillSpaceCompletely" };
+
+	stream << "Rule cache hits:" << '\n';
+	for (int i = 0; i < (int)CachedRule::Count; i++)
+	{
+		int hits = ruleCacheHits[i].load(std::memory_order_relaxed);
+		int total = hits + ruleCacheMisses[i].load(std::memory_order_relaxed);
+		stream << "  " << names[i] << ": " << hits << "/" << total;
+		if (total > 0)
+			stream << " (" << (100 * hits / total) << "%)";
+		stream << '\n';
+	}
 }
 
 void Solver::SolveUnreachable()
 {
+	UpdateSquareOwners();
+
 	board.ForEachSquare([this](const Point& pt, const Square& sq)
 	{
 		if (sq.GetState() != SquareState::Unknown)
 			return true;
 
-		bool isReachable = false;
-		for (int i = 0; i < unsolvedWhites.size() && !isReachable; i++)
-		{
-			auto& initialWhite = initialWhites[unsolvedWhites[i]];
-			auto region = Region(&board, initialWhite)
-				.ExpandAllInline([](const Point&, const Square& sq) { return sq.GetState() == SquareState::White; });
-
-			auto regionSquaresLeft = board.Get(initialWhite).GetSize() - region.GetSquareCount();
-			
-			region.ForEach([&pt, &isReachable, regionSquaresLeft](const Point& ptInner, const Square& sq)
-			{
-				if (Rules::CanReach(ptInner, pt, regionSquaresLeft))
-					isReachable = true;
-				return !isReachable;
-			});
-		}
-
-		if (!isReachable)
+		if (squareOwnerCounts[pt.y * board.GetWidth() + pt.x] == 0)
 		{
 			board.SetBlack(pt);
 			return RETURN_AFTER_FILLING_BLACK;
@@ -305,7 +693,7 @@ void Solver::SolveUnreachable()
 	});
 }
 
-bool Solver::SolveUnfinishedWhiteIsland()
+bool Solver::SolveUnfinishedWhiteIsland(const std::vector<int>& changedRoots)
 {
 	std::vector<int> badOrigins;
 
@@ -313,11 +701,14 @@ bool Solver::SolveUnfinishedWhiteIsland()
 	{
 		Point pt = initialWhites[unsolvedWhites[i]];
 
+		if (std::find(changedRoots.begin(), changedRoots.end(), FindWhite(pt.y * board.GetWidth() + pt.x)) == changedRoots.end())
+			continue;
+
 		auto region = Region(&board, pt);
 
 		bool reachedAnotherOrigin = false;
-		uint8_t sourceOrigin = region.GetSameOrigin();
-		uint8_t sourceSize = region.GetSameSize();
+		SquareValue sourceOrigin = region.GetSameOrigin();
+		SquareValue sourceSize = region.GetSameSize();
 
 		if (std::find(badOrigins.begin(), badOrigins.end(), sourceOrigin) != badOrigins.end())
 			continue;
@@ -329,7 +720,7 @@ bool Solver::SolveUnfinishedWhiteIsland()
 
 			if (square.GetState() == SquareState::White)
 			{
-				if (square.GetOrigin() != (uint8_t)~0 && square.GetOrigin() != sourceOrigin)
+				if (square.GetOrigin() != NoOrigin && square.GetOrigin() != sourceOrigin)
 				{
 					reachedAnotherOrigin = true;
 
@@ -440,6 +831,323 @@ bool Solver::SolveUnfinishedWhiteIsland()
 	return true;
 }
 
+// islands missing more squares than this are left to the other rules,
+// as the number of possible shapes grows exponentially with the size
+static const int maxShapeSquaresMissing = 7;
+static const int maxShapeSquares = 256;
+static const int maxShapeCandidates = 8192;
+
+namespace
+{
+	typedef std::bitset<maxShapeSquares> ShapeMask;
+
+	// Enumerates all connected shapes which contain the seed and have exactly
+	// `missing` squares more than it. Shapes are grown with Redelmeier's
+	// algorithm so every shape is visited exactly once and no shape has to be
+	// remembered, only the intersection of all of them.
+	struct ShapeEnumerator
+	{
+		int missing = 0;
+		int candidateCount = 0;
+		bool isAborted = false;
+
+		// neighbours which the shape may grow into, -1 if there is none
+		int neighbours[maxShapeSquares][4];
+		ShapeMask neighbourMask[maxShapeSquares];
+
+		ShapeMask seed;
+		ShapeMask whiteMask;
+		ShapeMask unknownMask;
+
+		ShapeMask shape;
+		ShapeMask marked;
+
+		ShapeMask inAll;
+		ShapeMask borderAll;
+
+		void Record(const ShapeMask& border)
+		{
+			auto outside = border & ~shape;
+
+			// shape would merge with a white that is not a part of it
+			if ((outside & whiteMask).any())
+				return;
+
+			if (candidateCount == 0)
+			{
+				inAll = shape;
+				borderAll = outside;
+			}
+			else
+			{
+				inAll &= shape;
+				borderAll &= outside;
+			}
+			candidateCount++;
+
+			if (candidateCount > maxShapeCandidates)
+				isAborted = true;
+
+			// nothing more can be learned from the remaining shapes
+			if (inAll == seed && (borderAll & unknownMask).none())
+				isAborted = true;
+		}
+
+		void Grow(const int* untried, int untriedCount, int depth, const ShapeMask& border)
+		{
+			while (untriedCount > 0 && !isAborted)
+			{
+				int square = untried[--untriedCount];
+				shape.set(square);
+
+				auto borderNext = border | neighbourMask[square];
+
+				if (depth + 1 == missing)
+				{
+					Record(borderNext);
+				}
+				else
+				{
+					int untriedNext[maxShapeSquares];
+					std::copy(untried, untried + untriedCount, untriedNext);
+					int untriedNextCount = untriedCount;
+
+					for (int n = 0; n < 4; n++)
+					{
+						int neighbour = neighbours[square][n];
+						if (neighbour < 0 || marked.test(neighbour))
+							continue;
+
+						marked.set(neighbour);
+						untriedNext[untriedNextCount++] = neighbour;
+					}
+
+					Grow(untriedNext, untriedNextCount, depth + 1, borderNext);
+
+					for (int n = untriedCount; n < untriedNextCount; n++)
+						marked.reset(untriedNext[n]);
+				}
+
+				shape.reset(square);
+			}
+		}
+	};
+}
+
+bool Solver::SolveIslandShapes()
+{
+	std::vector<int> originSquareCount(initialWhites.size(), 0);
+	board.ForEachSquare([&originSquareCount](const Point&, const Square& sq)
+	{
+		if (sq.GetState() == SquareState::White && sq.GetOrigin() != NoOrigin)
+			originSquareCount[sq.GetOrigin()]++;
+		return true;
+	});
+
+	std::vector<int> localIndex(board.GetWidth() * board.GetHeight(), -1);
+	std::vector<Point> squares;
+	std::vector<int> distances;
+	std::vector<bool> isGrowable;
+
+	auto enumerator = std::make_unique<ShapeEnumerator>();
+
+	// CheckForSolvedWhites modifies `unsolvedWhites` so we iterate over a copy
+	auto unsolved = unsolvedWhites;
+
+	for (int i = 0; i < unsolved.size(); i++)
+	{
+		if (std::find(unsolvedWhites.begin(), unsolvedWhites.end(), unsolved[i]) == unsolvedWhites.end())
+			continue;
+
+		SquareValue origin = (SquareValue)unsolved[i];
+		Point start = initialWhites[origin];
+		int size = board.GetRequiredSize(start);
+
+		auto AddSquare = [this, &localIndex, &squares, &distances, &isGrowable](const Point& pt, int distance, bool growable)
+		{
+			localIndex[pt.y * board.GetWidth() + pt.x] = (int)squares.size();
+			squares.push_back(pt);
+			distances.push_back(distance);
+			isGrowable.push_back(growable);
+		};
+
+		squares.clear();
+		distances.clear();
+		isGrowable.clear();
+
+		// collect current squares of the island, they form the seed of every shape
+		bool isValidSeed = true;
+		int seedOriginCount = 0;
+		AddSquare(start, 0, false);
+		for (int s = 0; s < squares.size() && isValidSeed; s++)
+		{
+			const Point neighbours[] = { squares[s].Left(), squares[s].Right(), squares[s].Up(), squares[s].Down() };
+			for (const auto& neighbour : neighbours)
+			{
+				if (!board.IsWhite(neighbour) || localIndex[neighbour.y * board.GetWidth() + neighbour.x] >= 0)
+					continue;
+
+				auto neighbourOrigin = board.Get(neighbour).GetOrigin();
+				if (neighbourOrigin != NoOrigin && neighbourOrigin != origin)
+				{
+					// touching another island, other rules will report this
+					isValidSeed = false;
+					break;
+				}
+
+				AddSquare(neighbour, 0, false);
+			}
+		}
+		int seedCount = (int)squares.size();
+		int missing = size - seedCount;
+
+		for (int s = 0; s < seedCount; s++)
+		{
+			if (board.Get(squares[s]).GetOrigin() == origin)
+				seedOriginCount++;
+		}
+
+		// ignore islands which have squares that are not connected to it yet
+		if (seedOriginCount != originSquareCount[origin])
+			isValidSeed = false;
+
+		if (missing <= 0 || missing > maxShapeSquaresMissing || seedCount > maxShapeSquares)
+			isValidSeed = false;
+
+		// find all squares within reach of the island and squares bordering them
+		for (int s = 0; s < squares.size() && isValidSeed; s++)
+		{
+			if (s >= seedCount && !isGrowable[s])
+				continue;
+
+			const Point neighbours[] = { squares[s].Left(), squares[s].Right(), squares[s].Up(), squares[s].Down() };
+			for (const auto& neighbour : neighbours)
+			{
+				if (!board.IsValidPosition(neighbour) || localIndex[neighbour.y * board.GetWidth() + neighbour.x] >= 0)
+					continue;
+
+				const auto& sq = board.Get(neighbour);
+				bool isFree =
+					sq.GetState() == SquareState::Unknown ||
+					(sq.GetState() == SquareState::White && sq.GetOrigin() == NoOrigin);
+
+				if (!isFree)
+					continue;
+
+				if (squares.size() >= maxShapeSquares)
+				{
+					isValidSeed = false;
+					break;
+				}
+
+				bool growable = distances[s] < missing && !IsTouchingAnotherIsland(neighbour, origin);
+				AddSquare(neighbour, distances[s] + 1, growable);
+			}
+		}
+
+		if (isValidSeed)
+		{
+			auto& e = *enumerator;
+			e.missing = missing;
+			e.candidateCount = 0;
+			e.isAborted = false;
+			e.seed.reset();
+			e.whiteMask.reset();
+			e.unknownMask.reset();
+
+			for (int s = 0; s < squares.size(); s++)
+			{
+				if (s < seedCount)
+					e.seed.set(s);
+
+				if (board.IsWhite(squares[s]))
+					e.whiteMask.set(s);
+				else
+					e.unknownMask.set(s);
+
+				if (s >= seedCount && !isGrowable[s])
+					continue;
+
+				e.neighbourMask[s].reset();
+				const Point neighbours[] = { squares[s].Left(), squares[s].Right(), squares[s].Up(), squares[s].Down() };
+				for (int n = 0; n < 4; n++)
+				{
+					e.neighbours[s][n] = -1;
+
+					if (!board.IsValidPosition(neighbours[n]))
+						continue;
+
+					int index = localIndex[neighbours[n].y * board.GetWidth() + neighbours[n].x];
+					if (index < 0)
+						continue;
+
+					e.neighbourMask[s].set(index);
+					if (isGrowable[index])
+						e.neighbours[s][n] = index;
+				}
+			}
+
+			e.shape = e.seed;
+			e.marked = e.seed;
+
+			ShapeMask border;
+			int untried[maxShapeSquares];
+			int untriedCount = 0;
+			for (int s = 0; s < seedCount; s++)
+			{
+				border |= e.neighbourMask[s];
+				for (int n = 0; n < 4; n++)
+				{
+					int neighbour = e.neighbours[s][n];
+					if (neighbour < 0 || e.marked.test(neighbour))
+						continue;
+
+					e.marked.set(neighbour);
+					untried[untriedCount++] = neighbour;
+				}
+			}
+
+			e.Grow(untried, untriedCount, 0, border);
+		}
+
+		for (int s = 0; s < squares.size(); s++)
+			localIndex[squares[s].y * board.GetWidth() + squares[s].x] = -1;
+
+		if (!isValidSeed || enumerator->isAborted)
+			continue;
+
+		// island cannot be completed in any way
+		if (enumerator->candidateCount == 0)
+			return false;
+
+		bool hasChanged = false;
+		for (int s = seedCount; s < squares.size(); s++)
+		{
+			if (enumerator->inAll.test(s))
+			{
+				if (board.IsWhite(squares[s]))
+					continue;
+
+				// origin is assigned by CheckForSolvedWhites once the square
+				// is connected, other rules expect islands to be contiguous
+				board.SetWhite(squares[s]);
+				startOfUnconnectedWhite.push_back(squares[s]);
+				hasChanged = true;
+			}
+			else if (enumerator->borderAll.test(s) && board.Get(squares[s]).GetState() == SquareState::Unknown)
+			{
+				board.SetBlack(squares[s]);
+				hasChanged = true;
+			}
+		}
+
+		if (hasChanged && !CheckForSolvedWhites())
+			return false;
+	}
+
+	return true;
+}
+
 bool Solver::SolveBalloonWhiteSimple()
 {
 	bool ret = true;
@@ -448,10 +1156,21 @@ bool Solver::SolveBalloonWhiteSimple()
 		if (r.GetState() != SquareState::White)
 			return true;
 
+		// unconnected whites have no version, only islands are cached
+		SquareValue origin = r.GetSameOrigin();
+		bool isIsland = origin != NoOrigin && r.Contains(initialWhites[origin]);
+
+		if (isIsland && IsRuleCached(CachedRule::BalloonWhiteSimple, origin))
+			return true;
+
 		auto result = SolveBalloonWhiteSimple(r);
 
 		if (result > 1)
+		{
+			if (isIsland)
+				CacheRule(CachedRule::BalloonWhiteSimple, origin);
 			return true;
+		}
 
 		if (result == 0)
 			ret = false;
@@ -504,7 +1223,7 @@ int Solver::SolveBalloonWhiteSimple(const Region& r)
 				if (expectedSize < actualSize + inflated.GetSquareCount() + spill.GetSquareCount())
 					return 2;
 
-				if (spill.GetSameOrigin() == (uint8_t)~0)
+				if (spill.GetSameOrigin() == NoOrigin)
 				{
 					Square sqBack;
 					if (!spill.StartNeighbourSpill(sqBack))
@@ -623,7 +1342,11 @@ bool Solver::SolveBalloonWhiteFillSpaceCompletely()
 {
 	for (int i = 0; i < unsolvedWhites.size(); i++)
 	{
-		auto white = Region(&board, initialWhites[unsolvedWhites[i]]);
+		SquareValue origin = (SquareValue)unsolvedWhites[i];
+		if (IsRuleCached(CachedRule::BalloonWhiteFillSpaceCompletely, origin))
+			continue;
+
+		auto white = Region(&board, initialWhites[origin]);
 		auto actualSize = white.GetSquareCount();
 		auto expectedSize = white.GetSameSize();
 
@@ -631,7 +1354,10 @@ bool Solver::SolveBalloonWhiteFillSpaceCompletely()
 
 		Square sq;
 		if (!white.StartNeighbourSpill(sq))
+		{
+			CacheRule(CachedRule::BalloonWhiteFillSpaceCompletely, origin);
 			continue;
+		}
 
 		auto spill = white.NeighbourSpill(sq);
 		auto inflated = Region::Union(white, spill);
@@ -659,6 +1385,8 @@ bool Solver::SolveBalloonWhiteFillSpaceCompletely()
 		{
 			return false;
 		}
+
+		CacheRule(CachedRule::BalloonWhiteFillSpaceCompletely, origin);
 	}
 
 	return true;
@@ -750,7 +1478,7 @@ bool Solver::SolveBlackAroundWhite()
 				if (sq.GetState() != SquareState::White)
 					return false;
 
-				if (sq.GetOrigin() == (uint8_t)~0)
+				if (sq.GetOrigin() == NoOrigin)
 					return false;
 
 				bool isContainedInRelevantRegion = true;
@@ -836,82 +1564,54 @@ bool Solver::SolveBlackAroundWhite()
 
 bool Solver::SolveUnconnectedWhiteHasOnlyOnePossibleOrigin()
 {
+	UpdateSquareOwners();
+
 	for (int i = 0; i < startOfUnconnectedWhite.size(); i++)
 	{
+		if (board.Get(startOfUnconnectedWhite[i]).GetOrigin() != NoOrigin)
+			continue;
+
 		auto white = Region(&board, startOfUnconnectedWhite[i])
 			.ExpandAllInline([](const Point&, const Square& sq) { return sq.GetState() == SquareState::White; });
 
-		auto relevantRegion = Region(white).ExpandAllInline([](const Point&, const Square& sq)
-		{
-			return
-				sq.GetState() == SquareState::Unknown ||
-				(sq.GetState() == SquareState::White && sq.GetOrigin() == (uint8_t)~0);
-		});
-
-		auto relevantWhites = relevantRegion.Neighbours([](const Point&, const Square& sq) { return sq.GetState() == SquareState::White && sq.GetOrigin() != (uint8_t)~0; });
+		if (white.GetSameOrigin() != NoOrigin)
+			continue;
 
-		auto obstructed = Region(&GetBoard());
+		// every square of the unconnected white has to be reached by the same island
+		SquareValue origin = NoOrigin;
+		bool hasMultiplePossibleOrigins = false;
+		bool isOrphan = false;
 
-		relevantWhites.ForEachContiguousRegion([&obstructed](const Region& white)
+		white.ForEach([this, &origin, &hasMultiplePossibleOrigins, &isOrphan](const Point& pt, const Square&)
 		{
-			Square sq;
-			if (!white.StartNeighbourSpill(sq))
-				return true;
-			
-			auto spill = white.NeighbourSpill(sq);
-			obstructed = Region::Union(obstructed, spill);
-			return true;
-		});
-
-		relevantRegion = Region::Subtract(relevantRegion, obstructed);
+			int index = pt.y * board.GetWidth() + pt.x;
 
-		uint8_t origin = ~0;
-		uint8_t size = 0;
-		bool hasMultiplePossibleOrigins = false;
-		
-		relevantRegion.ForEachContiguousRegion([&origin, &size, &hasMultiplePossibleOrigins, &obstructed, &white](const Region& r)
-		{
-			if (hasMultiplePossibleOrigins)
+			if (squareOwnerCounts[index] == 0)
+			{
+				isOrphan = true;
 				return false;
+			}
 
-			if (Region::Intersection(r, white) != white)
-				return true;
-
-			auto directWhites = Region::Intersection(obstructed, r.Neighbours());
-			directWhites.ExpandAllInline([](const Point&, const Square& sq) { return sq.GetState() == SquareState::White && sq.GetOrigin() != (uint8_t)~0; });
-
-			directWhites.ForEachContiguousRegion([&origin, &size, &hasMultiplePossibleOrigins](const Region& r)
+			if (squareOwnerCounts[index] > 1 || (origin != NoOrigin && origin != squareOwners[index]))
 			{
-				if (origin == (uint8_t)~0)
-				{
-					origin = r.GetSameOrigin();
-					size = r.GetSameSize();
-					return true;
-				}
-
-				if (origin != r.GetSameOrigin())
-				{
-					hasMultiplePossibleOrigins = true;
-					return false;
-				}
+				hasMultiplePossibleOrigins = true;
+				return false;
+			}
 
-				return true;
-			});
+			origin = squareOwners[index];
+			return true;
+		});
 
-			// one we reached and handled the right region, we can stop
+		if (isOrphan)
+		{
+			// found unconnected white with no possible connection
 			return false;
-		});
+		}
 
 		if (!hasMultiplePossibleOrigins)
 		{
-			if (origin == (uint8_t)~0)
-			{
-				// found unconnected white with no possible connection
-				return false;
-			}
-
 			white.SetOrigin(origin);
-			white.SetSize(size);
+			white.SetSize(board.GetRequiredSize(initialWhites[origin]));
 
 			if (!CheckForSolvedWhites())
 				return false;
@@ -923,45 +1623,62 @@ bool Solver::SolveUnconnectedWhiteHasOnlyOnePossibleOrigin()
 
 void Solver::SolveBlackInCorneredWhite2By3()
 {
-	ForEachRegion([](const Region& r)
+	ForEachRegion([this](const Region& r)
 	{
 		if (r.GetState() != SquareState::White)
 			return true;
 
-		if (r.GetSameOrigin() == (uint8_t)~0)
+		SquareValue origin = r.GetSameOrigin();
+		if (origin == NoOrigin)
 			return true;
 
-		Square sq;
-		if (!r.StartNeighbourSpill(sq))
+		bool isIsland = r.Contains(initialWhites[origin]);
+		if (isIsland && IsRuleCached(CachedRule::BlackInCorneredWhite2By3, origin))
 			return true;
 
-		auto spill = r.NeighbourSpill(sq);
-
-		if (spill.GetSquareCount() != 2)
+		if (!SolveBlackInCorneredWhite2By3(r))
+		{
+			if (isIsland)
+				CacheRule(CachedRule::BlackInCorneredWhite2By3, origin);
 			return true;
+		}
 
-		auto a = Region(spill.GetBoard(), spill.GetSquares()[0]).Neighbours([](const Point&, const Square& sq) { return sq.GetState() == SquareState::Unknown; });
-		auto b = Region(spill.GetBoard(), spill.GetSquares()[1]).Neighbours([](const Point&, const Square& sq) { return sq.GetState() == SquareState::Unknown; });
+		return RETURN_AFTER_FILLING_BLACK;
+	});
+}
 
-		auto possiblyBlack = Region::Intersection(a, b);
+bool Solver::SolveBlackInCorneredWhite2By3(const Region& r)
+{
+	Square sq;
+	if (!r.StartNeighbourSpill(sq))
+		return false;
 
-		if (possiblyBlack.GetSquareCount() != 1)
-			return true;
+	auto spill = r.NeighbourSpill(sq);
 
-		auto connectedWhite = possiblyBlack.Neighbours([&sq](const Point&, const Square& sqInner)
-		{
-			return
-				sqInner.GetState() == SquareState::White &&
-				sqInner.GetOrigin() != (uint8_t)~0 &&
-				sqInner.GetOrigin() != sq.GetOrigin();
-		});
+	if (spill.GetSquareCount() != 2)
+		return false;
 
-		if (connectedWhite.GetSquareCount() != 1)
-			return true;
+	auto a = Region(spill.GetBoard(), spill.GetSquares()[0]).Neighbours([](const Point&, const Square& sq) { return sq.GetState() == SquareState::Unknown; });
+	auto b = Region(spill.GetBoard(), spill.GetSquares()[1]).Neighbours([](const Point&, const Square& sq) { return sq.GetState() == SquareState::Unknown; });
 
-		possiblyBlack.SetState(SquareState::Black);
-		return RETURN_AFTER_FILLING_BLACK;
+	auto possiblyBlack = Region::Intersection(a, b);
+
+	if (possiblyBlack.GetSquareCount() != 1)
+		return false;
+
+	auto connectedWhite = possiblyBlack.Neighbours([&sq](const Point&, const Square& sqInner)
+	{
+		return
+			sqInner.GetState() == SquareState::White &&
+			sqInner.GetOrigin() != NoOrigin &&
+			sqInner.GetOrigin() != sq.GetOrigin();
 	});
+
+	if (connectedWhite.GetSquareCount() != 1)
+		return false;
+
+	possiblyBlack.SetState(SquareState::Black);
+	return true;
 }
 
 void Solver::SolveDisjointedBlack()
@@ -12,30 +12,30 @@ void Square::SetState(SquareState state)
 	this->state = state;
 }
 
-uint8_t Square::GetOrigin() const
+SquareValue Square::GetOrigin() const
 {
 	return origin;
 }
 
-void Square::SetOrigin(uint8_t origin)
+void Square::SetOrigin(SquareValue origin)
 {
 	this->origin = origin;
 }
 
-uint8_t Square::GetSize() const
+SquareValue Square::GetSize() const
 {
 	return size;
 }
 
-void Square::SetSize(uint8_t size)
+void Square::SetSize(SquareValue size)
 {
 	this->size = size;
 }
 
-Square::Square(SquareState state, uint8_t size)
+Square::Square(SquareState state, SquareValue size)
 	: state(state)
-	, origin(~0)
-	, size(size) // WARNING: unhandled overflow (this->size is not 8 bits)
+	, origin(NoOrigin)
+	, size(size)
 {
 
 }
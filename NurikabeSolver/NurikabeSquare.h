@@ -13,24 +13,34 @@ namespace Nurikabe
 		Wall
 	};
 
+	// Origin and size of a square. 16 bits allow boards far larger than anything
+	// solvable, and a square still fits into 6 bytes.
+	typedef uint16_t SquareValue;
+
+	// origin of a white square that is not known to belong to any clue
+	constexpr SquareValue NoOrigin = (SquareValue)~0;
+
+	// largest clue, origins have to stay below NoOrigin
+	constexpr int MaxSquareValue = NoOrigin - 1;
+
 	class Square
 	{
 		SquareState state;// : 2;
-		uint8_t origin;// : 7;
-		uint8_t size;// : 7;
+		SquareValue origin;
+		SquareValue size;
 
 	public:
 		void SetState(SquareState state);
 		SquareState GetState() const;
 
-		uint8_t GetOrigin() const;
-		void SetOrigin(uint8_t origin);
+		SquareValue GetOrigin() const;
+		void SetOrigin(SquareValue origin);
 
-		uint8_t GetSize() const;
-		void SetSize(uint8_t size);
+		SquareValue GetSize() const;
+		void SetSize(SquareValue size);
 
 	public:
-		Square(SquareState state, uint8_t size);
+		Square(SquareState state, SquareValue size);
 		Square();
 
 	public:
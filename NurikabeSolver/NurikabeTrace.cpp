@@ -0,0 +1,120 @@
+#include "NurikabeTrace.h"
+#include "NurikabeRequest.h"
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace Nurikabe;
+
+// Spans of one thread. The buffer outlives its thread, so spans of workers
+// that already ended are still written.
+struct ThreadTrace
+{
+	int threadId;
+	std::vector<TraceEvent> events;
+	size_t next = 0;
+	uint64_t total = 0;
+};
+
+static std::mutex traceMutex;
+static std::vector<std::shared_ptr<ThreadTrace>> traces;
+static size_t traceCapacity = Tracer::DefaultCapacity;
+
+static thread_local std::shared_ptr<ThreadTrace> threadTrace;
+
+void Tracer::Enable(size_t capacity)
+{
+	{
+		std::lock_guard<std::mutex> lock(traceMutex);
+		traceCapacity = capacity > 0 ? capacity : 1;
+	}
+	isEnabled = true;
+}
+
+void Tracer::Add(const TraceEvent& event)
+{
+	if (!threadTrace)
+	{
+		threadTrace = std::make_shared<ThreadTrace>();
+
+		std::lock_guard<std::mutex> lock(traceMutex);
+		threadTrace->threadId = (int)traces.size() + 1;
+		threadTrace->events.resize(traceCapacity);
+		traces.push_back(threadTrace);
+	}
+
+	auto& trace = *threadTrace;
+	trace.events[trace.next] = event;
+	trace.next = (trace.next + 1) % trace.events.size();
+	trace.total++;
+}
+
+static const char* GetOutcomeName(TraceOutcome outcome)
+{
+	const char* names[] = { "none", "changed", "unchanged", "contradiction", "solvable", "unsolvable", "solved", "branched" };
+	return names[(int)outcome];
+}
+
+// Events are complete events ("ph":"X") with timestamps in microseconds,
+// one per line so large traces stay readable with a text editor:
+//   {"traceEvents":[
+//   {"name":"PerSquare","ph":"X","pid":1,"tid":1,"ts":12.345,"dur":6.789,"args":{"solver":3,"depth":1,"outcome":"changed"}},
+//   ...
+//   ],"displayTimeUnit":"ms","otherData":{"droppedEvents":0}}
+bool Tracer::Write(const char* filename)
+{
+	std::ofstream stream(filename, std::ios::binary);
+	if (!stream)
+		return false;
+
+	std::lock_guard<std::mutex> lock(traceMutex);
+
+	// timestamps start at the first span, steady clock has no meaningful epoch
+	int64_t origin = INT64_MAX;
+	uint64_t droppedCount = 0;
+	for (const auto& trace : traces)
+	{
+		size_t count = trace->total < trace->events.size() ? trace->total : trace->events.size();
+		for (size_t i = 0; i < count; i++)
+			if (trace->events[i].startNs < origin)
+				origin = trace->events[i].startNs;
+		droppedCount += trace->total - count;
+	}
+
+	std::string out = "{\"traceEvents\":[\n";
+	bool isFirst = true;
+	for (const auto& trace : traces)
+	{
+		// oldest first, which is where the next span would go once the buffer is full
+		size_t count = trace->total < trace->events.size() ? trace->total : trace->events.size();
+		size_t first = trace->total < trace->events.size() ? 0 : trace->next;
+		for (size_t i = 0; i < count; i++)
+		{
+			const auto& event = trace->events[(first + i) % trace->events.size()];
+			if (!isFirst)
+				out += ",\n";
+			isFirst = false;
+
+			char line[160];
+			out += "{\"name\":";
+			AppendJsonString(out, event.name);
+			std::snprintf(line, sizeof(line), ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"solver\":%d,\"depth\":%d,\"outcome\":\"%s\"}}",
+				trace->threadId, (event.startNs - origin) / 1e3, event.durationNs / 1e3, event.solverId, (int)event.depth, GetOutcomeName(event.outcome));
+			out += line;
+
+			// large traces are written in pieces
+			if (out.size() > (1 << 20))
+			{
+				stream.write(out.data(), out.size());
+				out.clear();
+			}
+		}
+	}
+	out += "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" + std::to_string(droppedCount) + "}}\n";
+	stream.write(out.data(), out.size());
+
+	return (bool)stream;
+}
\ No newline at end of file
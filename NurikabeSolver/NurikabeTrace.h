@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace Nurikabe
+{
+	// how a traced span ended
+	enum class TraceOutcome : uint8_t
+	{
+		None,
+		Changed,
+		Unchanged,
+		Contradiction,
+		Solvable,
+		Unsolvable,
+		Solved,
+		Branched
+	};
+
+	// A finished span of work of one solver, see Tracer.
+	struct TraceEvent
+	{
+		// a string literal, or a name that lives as long as the program
+		const char* name;
+		int64_t startNs;
+		int64_t durationNs;
+		int solverId;
+		int16_t depth;
+		TraceOutcome outcome;
+	};
+
+	// Records spans of solving into a ring buffer of every thread and writes
+	// them as Chrome Trace Event JSON, which Perfetto and chrome://tracing load.
+	// Recording takes two clock reads and a store into memory of the thread,
+	// so the timing of solving barely changes. Once a buffer is full the oldest
+	// spans of that thread are overwritten. Until Enable is called a span costs
+	// a check of a flag.
+	class Tracer
+	{
+	public:
+		static constexpr size_t DefaultCapacity = 1 << 18;
+
+		static inline std::atomic<bool> isEnabled = false;
+
+		/// @brief Starts recording, every thread keeps the last @p capacity spans.
+		static void Enable(size_t capacity = DefaultCapacity);
+
+		/// @brief Writes spans of all threads, also of threads that ended, once no thread is solving anymore. Returns false when @p filename cannot be written.
+		static bool Write(const char* filename);
+
+		static int64_t Now()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		static void Add(const TraceEvent& event);
+	};
+
+	// Records a span from construction to destruction, or to Stop, when
+	// tracing is enabled. The span is added once it is destroyed, so the
+	// outcome can still be set after Stop.
+	class TraceSpan
+	{
+		TraceEvent event;
+		bool isRecording;
+
+	public:
+		TraceSpan(const char* name, int solverId, int depth)
+			: isRecording(Tracer::isEnabled.load(std::memory_order_relaxed))
+		{
+			if (!isRecording)
+				return;
+
+			event.name = name;
+			event.solverId = solverId;
+			event.depth = (int16_t)depth;
+			event.outcome = TraceOutcome::None;
+			event.durationNs = -1;
+			event.startNs = Tracer::Now();
+		}
+
+		~TraceSpan()
+		{
+			if (!isRecording)
+				return;
+
+			Stop();
+			Tracer::Add(event);
+		}
+
+		TraceSpan(const TraceSpan&) = delete;
+		TraceSpan& operator=(const TraceSpan&) = delete;
+
+		void Stop()
+		{
+			if (isRecording && event.durationNs < 0)
+				event.durationNs = Tracer::Now() - event.startNs;
+		}
+
+		/// @brief Drops the span, nothing is recorded.
+		void Cancel() { isRecording = false; }
+
+		void SetOutcome(TraceOutcome outcome) { event.outcome = outcome; }
+	};
+}
\ No newline at end of file
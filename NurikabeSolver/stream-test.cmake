@@ -0,0 +1,25 @@
+# Runs the solver in stream mode on stream-sample.jsonl and checks every line got its answer.
+# Usage: cmake -DSOLVER=<path> -DINPUT=<jsonl> -P stream-test.cmake
+
+execute_process(
+	COMMAND ${SOLVER} --stream
+	INPUT_FILE ${INPUT}
+	OUTPUT_VARIABLE output
+	RESULT_VARIABLE result
+)
+
+if (NOT result EQUAL 0)
+	message(FATAL_ERROR "Stream mode exited with ${result}")
+endif()
+
+foreach(expected
+	"{\"id\":1,\"status\":\"solved\",\"width\":5,\"height\":5,\"solution\":\"0111101001110010110101011\""
+	"{\"id\":\"10x10-2\",\"status\":\"solved\","
+	"{\"id\":\"broken\",\"status\":\"unsolved\","
+	"{\"id\":4,\"status\":\"error\","
+)
+	string(FIND "${output}" "${expected}" position)
+	if (position EQUAL -1)
+		message(FATAL_ERROR "Missing ${expected} in:\n${output}")
+	endif()
+endforeach()